@@ -1,4 +1,5 @@
 #include "Application.h"
+#include <algorithm>
 #include <cassert>
 #include "nfd.h"
 #include <imgui.h>
@@ -31,6 +32,7 @@ const std::array<uint8_t, 16> gSDLKeys = {
 };
 
 const float TIMER_INTERVAL = 1000.0f / 60.0f;
+const char* gScaleModeLabels[] = { "Stretch", "Integer", "Scale2x", "Scale3x", "xBR" };
 
 namespace fs = std::filesystem;
 Application::Application(const int width, const int height)
@@ -39,9 +41,7 @@ Application::Application(const int width, const int height)
     
     mWindow     = SDL_CreateWindow("CHIP-8 Emulator", width, height, SDL_WINDOW_RESIZABLE);
     mRenderer   = SDL_CreateRenderer(mWindow, nullptr);
-    mTexture    = SDL_CreateTexture(mRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,  OUTPUT_WIDTH, OUTPUT_HEIGHT);
-
-    SDL_SetTextureScaleMode(mTexture, SDL_SCALEMODE_NEAREST);
+    ResizeTexture(OUTPUT_WIDTH, OUTPUT_HEIGHT);
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -54,8 +54,10 @@ Application::Application(const int width, const int height)
     ImGui_ImplSDL3_InitForSDLRenderer(mWindow, mRenderer);
     ImGui_ImplSDLRenderer3_Init(mRenderer);
 
+    mPacer.Init(mWindow, mRenderer);
+
     mRomPath = "bin\\roms\\1-ibm-logo.ch8";
-    mEmulator.LoadROM(mRomPath);
+    ResetEmulator();
 }
 
 Application::~Application()
@@ -71,6 +73,34 @@ Application::~Application()
     SDL_Quit();
 }
 
+void Application::ResetEmulator()
+{
+    mEmulator = Chip();
+    mEmulator.LoadROM(mRomPath);
+    mFrameCount = 0;
+    mCompositor.Reset();
+    mMemoryViewer.Reset(mEmulator);
+    mAnalysis = RomAnalysis::Analyse(&mEmulator.mHeap[0x200], mEmulator.mRomSize);
+}
+
+bool Application::ResizeTexture(int width, int height)
+{
+    if (mTexture != nullptr && width == mTextureWidth && height == mTextureHeight)
+    {
+        return false;
+    }
+
+    if (mTexture != nullptr)
+    {
+        SDL_DestroyTexture(mTexture);
+    }
+    mTexture = SDL_CreateTexture(mRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    SDL_SetTextureScaleMode(mTexture, SDL_SCALEMODE_NEAREST);
+    mTextureWidth = width;
+    mTextureHeight = height;
+    return true;
+}
+
 bool Application::PollEvents()
 {
     SDL_Event event;
@@ -87,6 +117,10 @@ bool Application::PollEvents()
         if (it != gSDLKeys.end())
         {
             mEmulator.mKeypad[std::distance(gSDLKeys.begin(), it)] = isKeyDown;
+            if (isKeyDown && !event.key.repeat)
+            {
+                mPacer.OnInput(event.key.timestamp);
+            }
         }
         
         // Forward event to ImGui
@@ -98,22 +132,50 @@ bool Application::PollEvents()
 
 void Application::Update(float deltaTime)
 {
+    mFrameDelta = deltaTime;
+
+    // Time doesn't pass while the debugger holds the emulator.
+    if (mDebugger.IsPaused())
+    {
+        mInstructionAccumulator = 0.0f;
+        mTimerAccumulator = 0.0f;
+        return;
+    }
+    
     // Accumulate time
     mInstructionAccumulator += deltaTime;
     mTimerAccumulator += deltaTime;
 
     // Run emulator instructions at desired speed
+    uint32_t instructionCount = 0;
     while (mInstructionAccumulator >= GetTimePerInstruction())
     {
-        mEmulator.Process();
+        instructionCount++;
         mInstructionAccumulator -= GetTimePerInstruction();
     }
 
+    mStream.ApplyInput(mEmulator.mKeypad);
+
+    // Only pay for debug checks & tracing while they're in use.
+    mTrace.SetFrame(static_cast<uint32_t>(mFrameCount));
+    const uint8_t runFlags = (mDebugger.IsActive() ? RUN_DEBUG : 0) | (mTrace.IsRecording() ? RUN_TRACE : 0);
+    switch (runFlags)
+    {
+    case 0:                         mEmulator.Run<0>(instructionCount); break;
+    case RUN_DEBUG:                 mEmulator.Run<RUN_DEBUG>(instructionCount, &mDebugger); break;
+    case RUN_TRACE:                 mEmulator.Run<RUN_TRACE>(instructionCount, nullptr, &mTrace); break;
+    case RUN_DEBUG | RUN_TRACE:     mEmulator.Run<RUN_DEBUG | RUN_TRACE>(instructionCount, &mDebugger, &mTrace); break;
+    }
+
     // Tick timers at 60Hz
-    while (mTimerAccumulator >= TIMER_INTERVAL)
+    while (mTimerAccumulator >= TIMER_INTERVAL && !mDebugger.IsPaused())
     {
         mEmulator.DecrementTimers();
         mTimerAccumulator -= TIMER_INTERVAL;
+        mDebugger.OnFrame(++mFrameCount);
+        mMemoryViewer.OnFrame(mEmulator, mFrameCount);
+        mCapture.SubmitFrame(mEmulator.mDisplayOutput);
+        mStream.SubmitFrame(mEmulator.mDisplayOutput);
     }
 }
 
@@ -130,7 +192,9 @@ void Application::Render()
     ImGui::Render();
     
     ImGui_ImplSDLRenderer3_RenderDrawData(ImGui::GetDrawData(), mRenderer);
+    mPacer.BeforePresent();
     SDL_RenderPresent(mRenderer);
+    mPacer.AfterPresent();
 }
 
 void Application::RenderMenuBar()
@@ -149,8 +213,7 @@ void Application::RenderMenuBar()
                     fs::path relativePath = fs::relative(absolutePath, fs::current_path());
                     
                     mRomPath = relativePath.string();
-                    mEmulator = Chip();
-                    mEmulator.LoadROM(mRomPath);
+                    ResetEmulator();
                     free(outPath);
                 }
                 else if (result == NFD_CANCEL)
@@ -163,8 +226,7 @@ void Application::RenderMenuBar()
                 }
             }
             if (ImGui::MenuItem("Restart")) {
-                mEmulator = Chip();
-                mEmulator.LoadROM(mRomPath);
+                ResetEmulator();
             }
             if (ImGui::MenuItem("Save Quirks")) {
                 mEmulator.mQuirks.SaveConfig(mRomPath);
@@ -177,9 +239,8 @@ void Application::RenderMenuBar()
 
 void Application::RenderOutputPanel()
 {
-    int pitch = sizeof(uint32_t) * OUTPUT_WIDTH; 
-    SDL_UpdateTexture(mTexture, nullptr, mEmulator.mDisplayOutput.data(), pitch);
-    
+    const uint32_t* frame = mCompositor.Compose(mEmulator.mDisplayOutput, mFrameDelta);
+
     ImVec2 windowSize = ImGui::GetIO().DisplaySize;
     float panelWidth = windowSize.x * 0.7f;
     float panelHeight = windowSize.y - ImGui::GetFrameHeight();
@@ -191,23 +252,54 @@ void Application::RenderOutputPanel()
                  ImGuiWindowFlags_NoMove);
 
     ImGui::SliderFloat("Instructions Per Second", &mInstructionsPerSecond, 1.f, 1000.f);
+    ImGui::Combo("Scaling", &mScaleMode, gScaleModeLabels, static_cast<int>(std::size(gScaleModeLabels)));
 
     ImVec2 avail = ImGui::GetContentRegionAvail();
+    float targetWidth = 0.f;
+    float targetHeight = 0.f;
+
+    if (mScaleMode == 0)
+    {
+        ResizeTexture(OUTPUT_WIDTH, OUTPUT_HEIGHT);
+        SDL_UpdateTexture(mTexture, nullptr, frame, sizeof(uint32_t) * OUTPUT_WIDTH);
+        mTextureScaled = false;
 
-    // Calculate aspect ratio of the CHIP-8 output
-    float aspect = static_cast<float>(OUTPUT_WIDTH) / OUTPUT_HEIGHT;
-    float targetWidth = avail.x;
-    float targetHeight = avail.x / aspect;
+        // Calculate aspect ratio of the CHIP-8 output
+        float aspect = static_cast<float>(OUTPUT_WIDTH) / OUTPUT_HEIGHT;
+        targetWidth = avail.x;
+        targetHeight = avail.x / aspect;
 
-    // If that height is too much, scale down to fit vertically
-    if (targetHeight > avail.y)
+        // If that height is too much, scale down to fit vertically
+        if (targetHeight > avail.y)
+        {
+            targetHeight = avail.y;
+            targetWidth = avail.y * aspect;
+        }
+    }
+    else
     {
-        targetHeight = avail.y;
-        targetWidth = avail.y * aspect;
+        // Scaled on the CPU to the largest whole multiple that fits, then drawn 1:1 so every pixel is the same size.
+        const ScaleFilter filter = static_cast<ScaleFilter>(mScaleMode - 1);
+        const int filterScale = Upscaler::GetFilterScale(filter);
+        const int factor = std::max(1, static_cast<int>(std::min(avail.x / (OUTPUT_WIDTH * filterScale), avail.y / (OUTPUT_HEIGHT * filterScale))));
+
+        const uint32_t* scaled = mUpscaler.Scale(frame, OUTPUT_WIDTH, OUTPUT_HEIGHT, filter, factor);
+        const bool recreated = ResizeTexture(mUpscaler.GetWidth(), mUpscaler.GetHeight());
+        if (recreated || !mTextureScaled || !mUpscaler.WasCached())
+        {
+            SDL_UpdateTexture(mTexture, nullptr, scaled, sizeof(uint32_t) * mUpscaler.GetWidth());
+        }
+        mTextureScaled = true;
+
+        targetWidth = static_cast<float>(mUpscaler.GetWidth());
+        targetHeight = static_cast<float>(mUpscaler.GetHeight());
     }
 
     ImGui::Image((ImTextureID)mTexture, ImVec2(targetWidth, targetHeight));
+    const ImVec2 imagePosition = ImGui::GetItemRectMin();
     ImGui::End();
+
+    mPacer.DrawOverlay(ImVec2(imagePosition.x + 8.f, imagePosition.y + 8.f));
 }
 
 void Application::RenderDebugPanel()
@@ -226,7 +318,20 @@ void Application::RenderDebugPanel()
     ImGui::Text("Opcode: 0x%X", mEmulator.mInstruction);
     ImGui::Separator();
     
-    mEmulator.mQuirks.DrawImGuiMenu();
+    if (mEmulator.mQuirks.DrawImGuiMenu())
+    {
+        mEmulator.ApplyQuirks();
+    }
+    mDebugger.DrawImGuiMenu(mEmulator, mFrameCount);
+    mTrace.DrawImGuiMenu();
+    mPacer.DrawImGuiMenu();
+    mCompositor.DrawImGuiMenu();
+    if (!mCapture.IsRecording())
+    {
+        mCapture.mPalette = mCompositor.GetPalette();
+    }
+    mCapture.DrawImGuiMenu();
+    mStream.DrawImGuiMenu();
     
     if (ImGui::CollapsingHeader("Registers"))
     {
@@ -235,6 +340,7 @@ void Application::RenderDebugPanel()
             ImGui::Text("V[%X] = 0x%02X", i, mEmulator.mVariableRegisters[i]);
         }
     }
+    mMemoryViewer.DrawImGuiMenu(mEmulator);
     if (ImGui::CollapsingHeader("Keypad State"))
     {
         for (int i = 0; i < gSDLKeys.size(); ++i)
@@ -246,5 +352,56 @@ void Application::RenderDebugPanel()
             ImGui::Text("%s: %s", label.c_str(), mEmulator.mKeypad[i] ? "Pressed" : "Released");
         }
     }
+    RenderDisassembly();
     ImGui::End();
 }
+
+void Application::RenderDisassembly()
+{
+    if (!mAnalysis || !ImGui::CollapsingHeader("Disassembly"))
+    {
+        return;
+    }
+
+    ImGui::Text("%zu blocks, %zu subroutines, %zu self-modifying writes",
+                mAnalysis->mBlocks.size(), mAnalysis->mSubroutines.size(), mAnalysis->mSelfModifyingWrites.size());
+    ImGui::Checkbox("Follow Program Counter", &mFollowProgramCounter);
+
+    const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+    ImGui::BeginChild("DisassemblyListing", ImVec2(0, lineHeight * 24), ImGuiChildFlags_Borders);
+
+    const int currentLine = mAnalysis->FindListingLine(mEmulator.mProgramCounter);
+    if (mFollowProgramCounter && currentLine >= 0)
+    {
+        ImGui::SetScrollY(std::max(0.f, (currentLine - 8) * lineHeight));
+    }
+
+    // Only the visible rows are submitted, so listing size doesn't matter.
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(mAnalysis->mListing.size()), lineHeight);
+    while (clipper.Step())
+    {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        {
+            const RomAnalysis::ListingLine& line = mAnalysis->mListing[i];
+            ImVec4 colour = ImVec4(0.85f, 0.85f, 0.85f, 1.f);
+            if (line.mLabel)                                        { colour = ImVec4(0.55f, 0.75f, 1.f, 1.f); }
+            else if (line.mSelfModifying)                           { colour = ImVec4(1.f, 0.45f, 0.35f, 1.f); }
+            else if (line.mKind == RomAnalysis::ByteKind::Data)     { colour = ImVec4(0.6f, 0.85f, 0.6f, 1.f); }
+            else if (line.mKind == RomAnalysis::ByteKind::Unknown)  { colour = ImVec4(0.5f, 0.5f, 0.5f, 1.f); }
+
+            // Clicking an instruction toggles a breakpoint on it.
+            const bool breakpoint = !line.mLabel && mDebugger.HasBreakpoint(line.mAddress);
+            ImGui::PushID(i);
+            ImGui::PushStyleColor(ImGuiCol_Text, colour);
+            if (ImGui::Selectable((std::string(breakpoint ? "*" : " ") + (i == currentLine ? ">" : " ") + line.mText).c_str(), i == currentLine) &&
+                !line.mLabel && line.mKind == RomAnalysis::ByteKind::Code)
+            {
+                mDebugger.ToggleBreakpoint(line.mAddress);
+            }
+            ImGui::PopStyleColor();
+            ImGui::PopID();
+        }
+    }
+    ImGui::EndChild();
+}
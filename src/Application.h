@@ -1,6 +1,16 @@
 #pragma once
 #include <SDL3/SDL.h>
 #include "Chip8.h"
+#include "Compositor.h"
+#include "Debugger.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "MemoryViewer.h"
+#include "RomAnalysis.h"
+#include "StreamServer.h"
+#include "TraceRecorder.h"
+#include "Upscaler.h"
+#include <memory>
 
 class Application
 {
@@ -15,17 +25,39 @@ public:
     void RenderMenuBar();
     void RenderOutputPanel();
     void RenderDebugPanel();
+    void RenderDisassembly();
     
     float GetTimePerInstruction() { return 1000.f / mInstructionsPerSecond; }
+    FramePacer& GetFramePacer() { return mPacer; }
+    StreamServer& GetStreamServer() { return mStream; }
 private:
+    void ResetEmulator(); // Reloads mRomPath into a fresh emulator.
+    bool ResizeTexture(int width, int height); // Returns true if the texture was recreated.
+
     Chip mEmulator;
+    Debugger mDebugger;
+    TraceRecorder mTrace;
+    FramePacer mPacer;
+    Compositor mCompositor;
+    Upscaler mUpscaler;
+    FrameCapture mCapture;
+    StreamServer mStream;
+    MemoryViewer mMemoryViewer;
     std::string mRomPath;
+    std::shared_ptr<const RomAnalysis> mAnalysis;
+    bool mFollowProgramCounter = true;
     
     SDL_Window* mWindow;
     SDL_Renderer* mRenderer;
-    SDL_Texture* mTexture;
+    SDL_Texture* mTexture = nullptr;
+    int mTextureWidth = 0;
+    int mTextureHeight = 0;
+    bool mTextureScaled = false; // Texture holds mUpscaler's output, so a cached upscale needs no upload.
+    int mScaleMode = 1; // 0 stretches on the GPU, otherwise ScaleFilter + 1 at the largest integer scale that fits.
 
     float mInstructionsPerSecond = 700.f;
     float mInstructionAccumulator = 0.0f;
     float mTimerAccumulator = 0.0f;
+    float mFrameDelta = 0.0f; // Milliseconds since the last Update, drives the compositor's decay.
+    uint64_t mFrameCount = 0; // 60hz timer ticks since the ROM was loaded.
 };
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "Chip8.h"
+#include "Debugger.h"
+#include "TraceRecorder.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <random>
@@ -26,9 +30,6 @@ const std::array<uint8_t, 80> gFontData =
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-std::mt19937 mRng{ std::random_device{}() };
-std::uniform_int_distribution<uint16_t> mRandDist{0, 255};
-
 constexpr std::array<uint16_t, 16> Chip::mOpcodeMasks = {
     0xFFFF, // 0x0
     0xF000, // 0x1
@@ -89,32 +90,148 @@ Chip::Chip()
     // Load font into memory.
     memcpy(&mHeap[0x50], &gFontData, sizeof(gFontData));
     Op_ClearScreen();
+    ApplyQuirks();
 }
 
 Chip::~Chip()
 {
 }
 
+template <size_t... Quirks>
+constexpr std::array<Chip::ChipInstructionFuncPtr, sizeof...(Quirks)> Chip::MakeStepTable(std::index_sequence<Quirks...>)
+{
+    return { &Chip::Step<Quirks>... };
+}
+
+const std::array<Chip::ChipInstructionFuncPtr, QUIRK_COMBINATIONS> Chip::mStepTable = MakeStepTable(std::make_index_sequence<QUIRK_COMBINATIONS>{});
+
+void Chip::ApplyQuirks()
+{
+    mStep = mStepTable[mQuirks.GetFlags()];
+}
+
 void Chip::Process()
+{
+    (this->*mStep)();
+}
+
+template <uint8_t Quirks>
+void Chip::Step()
 {
     Fetch();
-    Execute(Decode());
+
+    // Switch dispatch mirroring mOpcodeMasks & mOpcodeBindings, unknown opcodes are ignored like Execute().
+    switch (mInstruction >> 12)
+    {
+    case 0x0:
+        if (mInstruction == 0x00E0)         { Op_ClearScreen(); }
+        else if (mInstruction == 0x00EE)    { Op_PopSubroutine(); }
+        break;
+    case 0x1: Op_Jump(); break;
+    case 0x2: Op_PushSubroutine(); break;
+    case 0x3: Op_SkipIfVxNnEqual(); break;
+    case 0x4: Op_SkipIfVxNnNotEqual(); break;
+    case 0x5: if ((mInstruction & 0x000F) == 0) { Op_SkipIfVxVyEqual(); } break;
+    case 0x6: Op_SetVxToNn(); break;
+    case 0x7: Op_AddNnToVx(); break;
+    case 0x8:
+        switch (mInstruction & 0x000F)
+        {
+        case 0x0: Op_SetVxToVy(); break;
+        case 0x1: Op_BinaryOR(); break;
+        case 0x2: Op_BinaryAND(); break;
+        case 0x3: Op_LogicalXOR(); break;
+        case 0x4: Op_AddWithCarry(); break;
+        case 0x5: Op_SubtractVyFromVx(); break;
+        case 0x6: Op_ShiftRight<Quirks>(); break;
+        case 0x7: Op_SubtractVxfromVy(); break;
+        case 0xE: Op_ShiftLeft<Quirks>(); break;
+        default: break;
+        }
+        break;
+    case 0x9: Op_SkipIfVxVyNotEqual(); break;
+    case 0xA: Op_SetIndexRegister(); break;
+    case 0xB: Op_JumpWithOffset<Quirks>(); break;
+    case 0xC: Op_Random(); break;
+    case 0xD: Op_Draw(); break;
+    case 0xE:
+        switch (mInstruction & 0x00FF)
+        {
+        case 0x9E: Op_SkipIfKeyPressed(); break;
+        case 0xA1: Op_SkipIfKeyNotPressed(); break;
+        default: break;
+        }
+        break;
+    case 0xF:
+        switch (mInstruction & 0x00FF)
+        {
+        case 0x07: Op_CacheDelayTimer(); break;
+        case 0x0A: Op_GetKey(); break;
+        case 0x15: Op_SetDelayTimer(); break;
+        case 0x18: Op_SetSoundTimer(); break;
+        case 0x1E: Op_AddToIndexRegister(); break;
+        case 0x29: Op_SetFontCharacter(); break;
+        case 0x33: Op_BinaryToDecimal(); break;
+        case 0x55: Op_StoreMemory<Quirks>(); break;
+        case 0x65: Op_LoadMemory<Quirks>(); break;
+        default: break;
+        }
+        break;
+    }
+}
+
+template <uint8_t Flags>
+uint32_t Chip::Run(uint32_t instructionCount, Debugger* debugger, TraceRecorder* trace)
+{
+    if constexpr ((Flags & RUN_TRACE) != 0)
+    {
+        trace->BeginRun(*this);
+    }
+
+    for (uint32_t i = 0; i < instructionCount; ++i)
+    {
+        if constexpr ((Flags & RUN_DEBUG) != 0)
+        {
+            if (debugger->ShouldBreak(*this)) { return i; }
+        }
+        if constexpr ((Flags & RUN_TRACE) != 0)
+        {
+            trace->BeforeStep(*this);
+        }
+        
+        Process();
+        
+        if constexpr ((Flags & RUN_TRACE) != 0)
+        {
+            trace->AfterStep(*this);
+        }
+    }
+    return instructionCount;
 }
 
+template uint32_t Chip::Run<0>(uint32_t, Debugger*, TraceRecorder*);
+template uint32_t Chip::Run<RUN_DEBUG>(uint32_t, Debugger*, TraceRecorder*);
+template uint32_t Chip::Run<RUN_TRACE>(uint32_t, Debugger*, TraceRecorder*);
+template uint32_t Chip::Run<RUN_DEBUG | RUN_TRACE>(uint32_t, Debugger*, TraceRecorder*);
+
 void Chip::Fetch()
 {
-    // Shift L part of instruction into the left half, then bitwise with R part.
-    mInstruction = (mHeap[mProgramCounter] << 8) | mHeap[mProgramCounter + 1];
+    mInstruction = PeekInstruction();
     
     // Increment program counter past instruction.
     mProgramCounter += 2;
 }
 
 uint16_t Chip::Decode() const
+{
+    return DecodeInstruction(mInstruction);
+}
+
+uint16_t Chip::DecodeInstruction(uint16_t instruction)
 {
     // Determine which opcode to run by applying mask based on the first nibble.
-    const uint16_t mask = mOpcodeMasks[mInstruction >> 12];
-    return mInstruction & mask;
+    const uint16_t mask = mOpcodeMasks[instruction >> 12];
+    return instruction & mask;
 }
 
 void Chip::Execute(uint16_t opcode)
@@ -126,35 +243,98 @@ void Chip::Execute(uint16_t opcode)
     }
 }
 
+uint16_t Chip::PeekInstruction() const
+{
+    // Shift L part of instruction into the left half, then bitwise with R part.
+    // Addresses wrap around the heap, a ROM jumping off the end must not read out of bounds.
+    return (mHeap[mProgramCounter & (HEAP_SIZE - 1)] << 8) | mHeap[(mProgramCounter + 1) & (HEAP_SIZE - 1)];
+}
+
+Chip::MemoryAccess Chip::GetMemoryAccess(uint16_t instruction) const
+{
+    const uint8_t x = (instruction >> 8) & 0x0F;
+    switch (DecodeInstruction(instruction))
+    {
+    case 0xD000: return { mIndexRegister, static_cast<uint8_t>(instruction & 0x0F), false };
+    case 0xF029: return { static_cast<uint16_t>(0x50 + static_cast<uint8_t>(mVariableRegisters[x] * 5)), 1, false };
+    case 0xF033: return { mIndexRegister, 3, true };
+    case 0xF055: return { mIndexRegister, static_cast<uint8_t>(x + 1), true };
+    case 0xF065: return { mIndexRegister, static_cast<uint8_t>(x + 1), false };
+    default: return {};
+    }
+}
+
 void Chip::DecrementTimers()
 {
     if (mDelayTimer > 0) mDelayTimer--;
     if (mSoundTimer > 0) mSoundTimer--;
 }
 
+void Chip::SeedRandom(uint32_t seed)
+{
+    mRng.seed(seed);
+}
+
 void Chip::LoadROM(const std::string& filename)
 {
     // Open the ROM file.
     std::ifstream file(filename, std::ios::binary);
-    assert(!file.fail(), "Filepath invalid");
+    assert(!file.fail() && "Filepath invalid");
 
     mQuirks.LoadConfig(filename);
+    ApplyQuirks();
     
     // Read the file into memory, starting at address 0x200
     file.read(reinterpret_cast<char*>(mHeap.data() + mProgramCounter), sizeof(mHeap) - mProgramCounter);
     
-    assert(file.gcount() != 0, "Invalid ROM data");
+    assert(file.gcount() != 0 && "Invalid ROM data");
+    mRomSize = static_cast<size_t>(file.gcount());
+    MarkHeapWritten(0x200, static_cast<uint16_t>(mRomSize));
     
     std::cout << "ROM loaded successfully." << std::endl;
 }
 
+void Chip::LoadProgram(const uint8_t* data, size_t size)
+{
+    mRomSize = std::min(size, mHeap.size() - 0x200);
+    memcpy(mHeap.data() + 0x200, data, mRomSize);
+    MarkHeapWritten(0x200, static_cast<uint16_t>(mRomSize));
+}
+
+void Chip::MarkHeapWritten(uint16_t address, uint16_t length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+
+    // Instruction writes are at most 16 bytes, so this is one or two pages in practice.
+    const uint32_t generation = ++mHeapGeneration;
+    for (uint32_t offset = 0; offset < length; offset += HEAP_PAGE_SIZE)
+    {
+        mHeapPageGenerations[((address + offset) & (HEAP_SIZE - 1)) / HEAP_PAGE_SIZE] = generation;
+    }
+    mHeapPageGenerations[((address + length - 1) & (HEAP_SIZE - 1)) / HEAP_PAGE_SIZE] = generation;
+}
+
+void Chip::ResetGenerations()
+{
+    mHeapGeneration = 0;
+    mHeapPageGenerations.fill(0);
+    mDisplayGeneration = 0;
+}
+
 void Chip::Op_ClearScreen()
 {
+    mDisplayGeneration++;
     std::fill(mDisplayOutput.begin(), mDisplayOutput.end(), 0);
 }
 
 void Chip::Op_PopSubroutine()
 {
+    // Returning with an empty stack is a ROM bug, ignore it rather than reading garbage.
+    if (mStack.empty()) { return; }
+    
     mProgramCounter = mStack.top();
     mStack.pop();
 }
@@ -257,6 +437,24 @@ void Chip::Op_ShiftLeft()
     mVariableRegisters[x] = value << 1;
 }
 
+template <uint8_t Quirks>
+void Chip::Op_ShiftRight()
+{
+    const uint8_t x = GetX();
+    uint8_t value = (Quirks & QUIRK_MODERN_SHIFT) ? mVariableRegisters[x] : mVariableRegisters[GetY()];
+    mVariableRegisters[0xF] = value & 0x01;
+    mVariableRegisters[x] = value >> 1;
+}
+
+template <uint8_t Quirks>
+void Chip::Op_ShiftLeft()
+{
+    const uint8_t x = GetX();
+    uint8_t value = (Quirks & QUIRK_MODERN_SHIFT) ? mVariableRegisters[x] : mVariableRegisters[GetY()];
+    mVariableRegisters[0xF] = (value >> 7) & 0x01;
+    mVariableRegisters[x] = value << 1;
+}
+
 void Chip::Op_SkipIfVxVyNotEqual()
 {
     mProgramCounter += (mVariableRegisters[GetX()] != mVariableRegisters[GetY()]) * 2;
@@ -281,20 +479,36 @@ void Chip::Op_JumpWithOffset()
     }
 }
 
+template <uint8_t Quirks>
+void Chip::Op_JumpWithOffset()
+{
+    if constexpr ((Quirks & QUIRK_SUPER_CHIP_JUMP) != 0) // SUPER-CHIP style: XNN + VX
+    {
+        const uint8_t x = GetX();
+        mProgramCounter = (x << 8) | GetNN();
+        mProgramCounter += mVariableRegisters[x];
+    }
+    else
+    {
+        mProgramCounter = GetNNN() + mVariableRegisters[0];
+    }
+}
+
 void Chip::Op_Random()
 {
-    const uint8_t random = static_cast<uint8_t>(mRandDist(mRng));
+    std::uniform_int_distribution<uint16_t> distribution{0, 255};
+    const uint8_t random = static_cast<uint8_t>(distribution(mRng));
     mVariableRegisters[GetX()] = random & GetNN();
 }
 
 void Chip::Op_SkipIfKeyPressed()
 {
-    mProgramCounter += (mKeypad[mVariableRegisters[GetX()]] * 2);
+    mProgramCounter += (mKeypad[mVariableRegisters[GetX()] & 0xF] * 2);
 }
 
 void Chip::Op_SkipIfKeyNotPressed()
 {
-    mProgramCounter += (!mKeypad[mVariableRegisters[GetX()]] * 2);
+    mProgramCounter += (!mKeypad[mVariableRegisters[GetX()] & 0xF] * 2);
 }
 
 void Chip::Op_CacheDelayTimer()
@@ -343,9 +557,10 @@ void Chip::Op_BinaryToDecimal()
 {
     const uint8_t value = mVariableRegisters[GetX()];
 
-    mHeap[mIndexRegister + 0] = value / 100;             // XXX
-    mHeap[mIndexRegister + 1] = (value / 10) % 10;       // XX
-    mHeap[mIndexRegister + 2] = value % 10;              // X
+    mHeap[(mIndexRegister + 0) & (HEAP_SIZE - 1)] = value / 100;             // XXX
+    mHeap[(mIndexRegister + 1) & (HEAP_SIZE - 1)] = (value / 10) % 10;       // XX
+    mHeap[(mIndexRegister + 2) & (HEAP_SIZE - 1)] = value % 10;              // X
+    MarkHeapWritten(mIndexRegister, 3);
 }
 
 void Chip::Op_StoreMemory()
@@ -353,8 +568,9 @@ void Chip::Op_StoreMemory()
     const uint8_t x = GetX();
     for (uint8_t i = 0; i <= x; ++i)
     {
-        mHeap[mIndexRegister + i] = mVariableRegisters[i];
+        mHeap[(mIndexRegister + i) & (HEAP_SIZE - 1)] = mVariableRegisters[i];
     }
+    MarkHeapWritten(mIndexRegister, x + 1);
     
     if (!mQuirks.mModernLoadStore)
     {
@@ -367,7 +583,7 @@ void Chip::Op_LoadMemory()
     const uint8_t x = GetX();
     for (uint8_t i = 0; i <= x; ++i)
     {
-        mVariableRegisters[i] = mHeap[mIndexRegister + i];
+        mVariableRegisters[i] = mHeap[(mIndexRegister + i) & (HEAP_SIZE - 1)];
     }
     
     if (!mQuirks.mModernLoadStore)
@@ -376,6 +592,37 @@ void Chip::Op_LoadMemory()
     }
 }
 
+template <uint8_t Quirks>
+void Chip::Op_StoreMemory()
+{
+    const uint8_t x = GetX();
+    for (uint8_t i = 0; i <= x; ++i)
+    {
+        mHeap[(mIndexRegister + i) & (HEAP_SIZE - 1)] = mVariableRegisters[i];
+    }
+    MarkHeapWritten(mIndexRegister, x + 1);
+    
+    if constexpr ((Quirks & QUIRK_MODERN_LOAD_STORE) == 0)
+    {
+        mIndexRegister += x + 1;
+    }
+}
+
+template <uint8_t Quirks>
+void Chip::Op_LoadMemory()
+{
+    const uint8_t x = GetX();
+    for (uint8_t i = 0; i <= x; ++i)
+    {
+        mVariableRegisters[i] = mHeap[(mIndexRegister + i) & (HEAP_SIZE - 1)];
+    }
+    
+    if constexpr ((Quirks & QUIRK_MODERN_LOAD_STORE) == 0)
+    {
+        mIndexRegister += x + 1;
+    }
+}
+
 void Chip::Op_Draw()
 {
     // Bitwise AND for wrapping.
@@ -384,6 +631,8 @@ void Chip::Op_Draw()
     uint8_t startY = mVariableRegisters[GetY()] & (OUTPUT_HEIGHT - 1);
     const uint8_t n = GetN();
     
+    mDisplayGeneration++;
+
     // Reset VF flag.
     mVariableRegisters[0xF] = 0;
     
@@ -393,7 +642,7 @@ void Chip::Op_Draw()
         const uint8_t currentY = startY + row;
         if (currentY >= OUTPUT_HEIGHT) { break; }
             
-        const uint8_t spriteByte = mHeap[mIndexRegister + row];
+        const uint8_t spriteByte = mHeap[(mIndexRegister + row) & (HEAP_SIZE - 1)];
         
         // Loop through each pixel in the sprite row
         for (uint8_t col = 0; col < 8; col++)
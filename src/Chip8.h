@@ -15,29 +15,71 @@
 #include <map>
 #include <stack>
 #include <bitset>
+#include <random>
+#include <utility>
 #include "QuirkStorage.h"
 
+class Debugger;
+class TraceRecorder;
+
+// Instrumentation compiled into a Chip::Run instantiation.
+enum RunFlags : uint8_t
+{
+    RUN_DEBUG   = 1 << 0, // Consult the debugger before each instruction.
+    RUN_TRACE   = 1 << 1, // Record each instruction to the trace recorder.
+};
+
 class Chip
 {
 public:
+    // Heap range an instruction reads or writes, excluding the instruction fetch itself.
+    struct MemoryAccess
+    {
+        uint16_t mAddress = 0;
+        uint8_t mLength = 0; // 0 if the instruction doesn't touch the heap.
+        bool mWrite = false;
+    };
+    
     Chip();
     ~Chip();
 
 	void LoadROM(const std::string& filename);
+	void LoadProgram(const uint8_t* data, size_t size); // Copies a ROM image to 0x200 without touching quirk config.
+    void ApplyQuirks(); // Selects the interpreter specialised for mQuirks, call after changing them.
     void Process();
+
+    // Runs up to instructionCount instructions, returning how many ran (fewer if the debugger breaks).
+    // Instrumentation is selected by RunFlags at compile time, Run<0> is a plain loop over Process().
+    template <uint8_t Flags>
+    uint32_t Run(uint32_t instructionCount, Debugger* debugger = nullptr, TraceRecorder* trace = nullptr);
 	
     void Fetch();
     uint16_t Decode() const;
+    static uint16_t DecodeInstruction(uint16_t instruction); // Masks an instruction down to its opcode binding key.
+    uint16_t PeekInstruction() const; // Instruction at the program counter, without fetching it.
+    MemoryAccess GetMemoryAccess(uint16_t instruction) const;
     void Execute(uint16_t opcode);
 	void DecrementTimers();
+	void SeedRandom(uint32_t seed); // Makes CXNN deterministic, used for reproducible runs.
     
     uint16_t mProgramCounter = 0x200; // Points to the current instruction in memory.
     uint16_t mIndexRegister = 0; // Stores a memory address used by opcodes.
     std::array<uint8_t, 16> mVariableRegisters = { 0 }; // General purpose variable registers.
-    std::array<uint8_t, HEAP_SIZE> mHeap; // First 512 bytes reserved for compatibility.
+    std::array<uint8_t, HEAP_SIZE> mHeap = { 0 }; // First 512 bytes reserved for compatibility.
     std::stack<uint16_t> mStack;
+    size_t mRomSize = 0; // Bytes of program loaded at 0x200.
+
+    // Heap writes stamp the pages they touch with a new generation, so viewers only re-diff pages written since
+    // the generation they last saw rather than the whole heap.
+    static constexpr size_t HEAP_PAGE_SIZE = 64;
+    static constexpr size_t HEAP_PAGES = HEAP_SIZE / HEAP_PAGE_SIZE;
+    void MarkHeapWritten(uint16_t address, uint16_t length); // Call after writing mHeap from outside the instruction set.
+    uint32_t GetHeapGeneration() const { return mHeapGeneration; }
+    uint32_t GetPageGeneration(size_t page) const { return mHeapPageGenerations[page]; }
+    uint32_t GetDisplayGeneration() const { return mDisplayGeneration; } // Bumped by every clear & draw.
+    void ResetGenerations(); // For tools reusing a Chip between unrelated runs, viewers must resync afterwards.
 
-	// External implementation could lerp to new value, giving a CRT-like appearance.
+	// Raw on/off pixels, the Compositor lerps toward these for a CRT-like appearance.
 	std::array<uint32_t, OUTPUT_WIDTH * OUTPUT_HEIGHT> mDisplayOutput;
 
 	QuirkStorage mQuirks;
@@ -56,11 +98,26 @@ public:
 	std::array<bool, 16> mKeypad = { 0 };
 	
 private:
+	std::mt19937 mRng{ std::random_device{}() };
+
+    uint32_t mHeapGeneration = 0;
+    std::array<uint32_t, HEAP_PAGES> mHeapPageGenerations = {};
+    uint32_t mDisplayGeneration = 0;
+	
     // Instructions ====================================================================================================
     using ChipInstructionFuncPtr = void (Chip::*)();
 	static const std::array<uint16_t, 16> mOpcodeMasks;
     std::map<uint16_t, ChipInstructionFuncPtr> mOpcodeBindings;
 
+	// Quirk specialised interpreter used by Process(), one instantiation per QuirkFlags combination.
+	// Quirk checks resolve at compile time, Execute() remains the runtime-checked reference.
+	template <uint8_t Quirks>
+	void Step();
+	template <size_t... Quirks>
+	static constexpr std::array<ChipInstructionFuncPtr, sizeof...(Quirks)> MakeStepTable(std::index_sequence<Quirks...>);
+	static const std::array<ChipInstructionFuncPtr, QUIRK_COMBINATIONS> mStepTable;
+	ChipInstructionFuncPtr mStep = nullptr;
+
 	// Base Instruction Set ===================
 	void Op_ClearScreen();				// 00E0
 	void Op_PopSubroutine();			// 00EE
@@ -80,9 +137,12 @@ private:
 	void Op_SubtractVxfromVy();			// 8XY7
 	void Op_ShiftRight();				// 8XY6
 	void Op_ShiftLeft();				// 8XYE
+	template <uint8_t Quirks> void Op_ShiftRight();
+	template <uint8_t Quirks> void Op_ShiftLeft();
 	void Op_SkipIfVxVyNotEqual();		// 9XY0
 	void Op_SetIndexRegister();			// ANNN
 	void Op_JumpWithOffset();			// BNNN
+	template <uint8_t Quirks> void Op_JumpWithOffset();
 	void Op_Random();					// CXNN
 	void Op_SkipIfKeyPressed();			// EX9E
 	void Op_SkipIfKeyNotPressed();		// EXA1
@@ -95,5 +155,7 @@ private:
 	void Op_BinaryToDecimal();			// FX33
 	void Op_StoreMemory();				// FX55
 	void Op_LoadMemory();				// FX65
+	template <uint8_t Quirks> void Op_StoreMemory();
+	template <uint8_t Quirks> void Op_LoadMemory();
 	void Op_Draw();						// DXYN
 };
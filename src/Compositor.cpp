@@ -0,0 +1,185 @@
+#include "Compositor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <imgui.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COMPOSITOR_SSE2 1
+#include <emmintrin.h>
+#else
+#define COMPOSITOR_SSE2 0
+#endif
+
+struct BlendParameters
+{
+    float mAttack;      // Fraction of the distance to a higher target covered this frame.
+    float mRelease;     // Fraction of the distance to a lower target covered this frame.
+    float mFrameBlend;
+    float mOff[4];      // RGBA, 0-255.
+    float mDelta[4];    // On - Off.
+};
+
+// Kernels ============================================================================================================
+// Both kernels compute, per pixel:
+//   target    = max(current lit, previous lit * blend), blend is 0 once the previous frame is a tick old
+//   intensity += (target - intensity) * (target > intensity ? attack : release)
+//   output    = off + (on - off) * intensity, packed as RGBA8888.
+
+static void ComposeScalar(const uint32_t* current, const uint32_t* previous, float* intensity, uint32_t* output,
+                          size_t count, const BlendParameters& parameters)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float lit = current[i] != 0 ? 1.f : 0.f;
+        const float target = std::max(lit, previous[i] != 0 ? parameters.mFrameBlend : 0.f);
+        const float factor = target > intensity[i] ? parameters.mAttack : parameters.mRelease;
+        intensity[i] += (target - intensity[i]) * factor;
+
+        uint32_t pixel = 0;
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            const float value = parameters.mOff[channel] + parameters.mDelta[channel] * intensity[i];
+            pixel |= static_cast<uint32_t>(value + 0.5f) << (24 - channel * 8);
+        }
+        output[i] = pixel;
+    }
+}
+
+#if COMPOSITOR_SSE2
+// 4 pixels per iteration, SSE2 is baseline on every x86-64 target so no runtime dispatch is needed.
+static size_t ComposeSSE2(const uint32_t* current, const uint32_t* previous, float* intensity, uint32_t* output,
+                          size_t count, const BlendParameters& parameters)
+{
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 blend = _mm_set1_ps(parameters.mFrameBlend);
+    const __m128 attack = _mm_set1_ps(parameters.mAttack);
+    const __m128 release = _mm_set1_ps(parameters.mRelease);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128 off[4], delta[4];
+    for (int channel = 0; channel < 4; ++channel)
+    {
+        // Rounding is folded into the offset since the conversion below truncates.
+        off[channel] = _mm_set1_ps(parameters.mOff[channel] + 0.5f);
+        delta[channel] = _mm_set1_ps(parameters.mDelta[channel]);
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        // Lit pixels are any non-zero value, turn the != 0 mask into 1.0f / 0.0f lanes.
+        const __m128 currentOff = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(current + i)), zero));
+        const __m128 previousOff = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i)), zero));
+        const __m128 target = _mm_max_ps(_mm_andnot_ps(currentOff, one), _mm_andnot_ps(previousOff, blend));
+
+        __m128 value = _mm_loadu_ps(intensity + i);
+        const __m128 rising = _mm_cmpgt_ps(target, value);
+        const __m128 factor = _mm_or_ps(_mm_and_ps(rising, attack), _mm_andnot_ps(rising, release));
+        value = _mm_add_ps(value, _mm_mul_ps(_mm_sub_ps(target, value), factor));
+        _mm_storeu_ps(intensity + i, value);
+
+        const __m128i r = _mm_cvttps_epi32(_mm_add_ps(off[0], _mm_mul_ps(delta[0], value)));
+        const __m128i g = _mm_cvttps_epi32(_mm_add_ps(off[1], _mm_mul_ps(delta[1], value)));
+        const __m128i b = _mm_cvttps_epi32(_mm_add_ps(off[2], _mm_mul_ps(delta[2], value)));
+        const __m128i a = _mm_cvttps_epi32(_mm_add_ps(off[3], _mm_mul_ps(delta[3], value)));
+        const __m128i pixels = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 24), _mm_slli_epi32(g, 16)),
+                                            _mm_or_si128(_mm_slli_epi32(b, 8), a));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), pixels);
+    }
+    return i;
+}
+#endif
+
+// Converts a half-life into the fraction of the remaining distance covered over deltaTime.
+static float HalfLifeFactor(float halfLife, float deltaTime)
+{
+    if (halfLife <= 0.f) { return 1.f; }
+    return 1.f - std::exp2(-deltaTime / halfLife);
+}
+
+// Compositor =========================================================================================================
+Compositor::Compositor()
+{
+    Reset();
+}
+
+void Compositor::Reset()
+{
+    mIntensity.fill(0.f);
+    mCurrentFrame.fill(0);
+    mPreviousFrame.fill(0);
+    mPreviousFrameAge = 0.f;
+    mOutput.fill(0);
+}
+
+const uint32_t* Compositor::Compose(const std::array<uint32_t, OUTPUT_WIDTH * OUTPUT_HEIGHT>& frame, float deltaTime)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // The previous frame is the last distinct one, so rendering faster than the emulator draws doesn't shorten it.
+    // It's only held for a tick though, otherwise a static screen would keep whatever was erased last lit forever.
+    if (memcmp(frame.data(), mCurrentFrame.data(), sizeof(mCurrentFrame)) != 0)
+    {
+        mPreviousFrame = mCurrentFrame;
+        mCurrentFrame = frame;
+        mPreviousFrameAge = 0.f;
+    }
+    else
+    {
+        mPreviousFrameAge += deltaTime;
+    }
+
+    BlendParameters parameters;
+    parameters.mAttack = HalfLifeFactor(mRiseHalfLife, deltaTime);
+    parameters.mRelease = HalfLifeFactor(mDecayHalfLife, deltaTime);
+    parameters.mFrameBlend = mPreviousFrameAge < PREVIOUS_FRAME_HOLD ? mFrameBlend : 0.f;
+    for (int channel = 0; channel < 4; ++channel)
+    {
+        const float on = channel < 3 ? mOnColour[channel] * 255.f : 255.f;
+        const float off = channel < 3 ? mOffColour[channel] * 255.f : 255.f;
+        parameters.mOff[channel] = off;
+        parameters.mDelta[channel] = on - off;
+    }
+
+    size_t done = 0;
+#if COMPOSITOR_SSE2
+    done = ComposeSSE2(mCurrentFrame.data(), mPreviousFrame.data(), mIntensity.data(), mOutput.data(), PIXEL_COUNT, parameters);
+#endif
+    ComposeScalar(mCurrentFrame.data() + done, mPreviousFrame.data() + done, mIntensity.data() + done, mOutput.data() + done,
+                  PIXEL_COUNT - done, parameters);
+
+    const float elapsed = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+    mComposeMicroseconds += (elapsed - mComposeMicroseconds) * 0.05f;
+    return mOutput.data();
+}
+
+std::array<uint32_t, 2> Compositor::GetPalette() const
+{
+    auto pack = [](const std::array<float, 3>& colour)
+    {
+        uint32_t packed = 0xFF;
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            packed |= static_cast<uint32_t>(std::clamp(colour[channel], 0.f, 1.f) * 255.f + 0.5f) << (24 - channel * 8);
+        }
+        return packed;
+    };
+    return { pack(mOffColour), pack(mOnColour) };
+}
+
+void Compositor::DrawImGuiMenu()
+{
+    if (!ImGui::CollapsingHeader("Display"))
+    {
+        return;
+    }
+
+    ImGui::SliderFloat("Decay Half-Life", &mDecayHalfLife, 0.f, 100.f, "%.1f ms");
+    ImGui::SliderFloat("Rise Half-Life", &mRiseHalfLife, 0.f, 50.f, "%.1f ms");
+    ImGui::SliderFloat("Frame Blend", &mFrameBlend, 0.f, 1.f, "%.2f");
+    ImGui::ColorEdit3("On Colour", mOnColour.data());
+    ImGui::ColorEdit3("Off Colour", mOffColour.data());
+    ImGui::Text("Compose: %.1f us", mComposeMicroseconds);
+}
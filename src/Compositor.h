@@ -0,0 +1,38 @@
+#pragma once
+#include "Chip8.h"
+#include <array>
+#include <cstdint>
+
+// Turns the core's on/off framebuffer into the displayed RGBA8888 frame.
+// Each pixel keeps an intensity that rises & decays exponentially toward its target, the target optionally holding
+// pixels lit in the previous frame for one 60hz tick so sprites erased & redrawn with XOR don't flicker.
+class Compositor
+{
+public:
+    Compositor();
+
+    // Returns OUTPUT_WIDTH * OUTPUT_HEIGHT pixels, valid until the next call.
+    const uint32_t* Compose(const std::array<uint32_t, OUTPUT_WIDTH * OUTPUT_HEIGHT>& frame, float deltaTime);
+    void Reset();
+    std::array<uint32_t, 2> GetPalette() const; // Off & on colours as RGBA8888, for consumers of the raw framebuffer.
+
+    void DrawImGuiMenu();
+
+    float mDecayHalfLife = 8.f; // Milliseconds for an unlit pixel to fall to half intensity, 0 is instant.
+    float mRiseHalfLife = 0.f;  // Milliseconds for a lit pixel to reach half intensity, 0 is instant.
+    float mFrameBlend = 0.75f;  // Weight of the previous frame's pixels in the target while it's held, 0 disables.
+    std::array<float, 3> mOnColour = { 1.f, 1.f, 1.f };
+    std::array<float, 3> mOffColour = { 0.f, 0.f, 0.f };
+
+private:
+    static constexpr size_t PIXEL_COUNT = OUTPUT_WIDTH * OUTPUT_HEIGHT;
+    static constexpr float PREVIOUS_FRAME_HOLD = 1000.f / 60.f; // Milliseconds, after which only decay keeps it lit.
+
+    alignas(16) std::array<float, PIXEL_COUNT> mIntensity;
+    alignas(16) std::array<uint32_t, PIXEL_COUNT> mCurrentFrame;  // Last frame seen.
+    alignas(16) std::array<uint32_t, PIXEL_COUNT> mPreviousFrame; // Frame before mCurrentFrame changed.
+    float mPreviousFrameAge = 0.f;                                  // Milliseconds since mCurrentFrame changed.
+    alignas(16) std::array<uint32_t, PIXEL_COUNT> mOutput;
+
+    float mComposeMicroseconds = 0.f;
+};
@@ -0,0 +1,262 @@
+#include "Debugger.h"
+#include "Chip8.h"
+#include <algorithm>
+#include <cstdio>
+#include <imgui.h>
+
+const char* gComparisonLabels[] = { "==", "!=", "<", ">" };
+const char* gRegisterLabels[] = { "V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7",
+                                  "V8", "V9", "VA", "VB", "VC", "VD", "VE", "VF" };
+
+static bool Compare(uint8_t lhs, Debugger::Comparison comparison, uint8_t rhs)
+{
+    switch (comparison)
+    {
+    case Debugger::Comparison::Equal:       return lhs == rhs;
+    case Debugger::Comparison::NotEqual:    return lhs != rhs;
+    case Debugger::Comparison::Less:        return lhs < rhs;
+    case Debugger::Comparison::Greater:     return lhs > rhs;
+    }
+    return false;
+}
+
+bool Debugger::ShouldBreak(const Chip& chip)
+{
+    if (mPaused) { return true; }
+
+    const bool resuming = mResuming;
+    mResuming = false;
+
+    // Steps are armed by the first instruction, then complete once the call depth condition holds.
+    if (mStepMode != StepMode::None)
+    {
+        if (mStepArmed)
+        {
+            const size_t depth = chip.mStack.size();
+            const bool done = mStepMode == StepMode::Into ||
+                              (mStepMode == StepMode::Over && depth <= mStepDepth) ||
+                              (mStepMode == StepMode::Out && depth < mStepDepth);
+            if (done)
+            {
+                Pause("Step");
+                return true;
+            }
+        }
+        mStepArmed = true;
+    }
+
+    if (resuming) { return false; }
+    return CheckBreakpoints(chip) || CheckWatchpoints(chip);
+}
+
+void Debugger::OnFrame(uint64_t frame)
+{
+    if (mRunToFrame != 0 && frame >= mRunToFrame)
+    {
+        Pause("Reached frame " + std::to_string(frame));
+    }
+}
+
+bool Debugger::IsActive() const
+{
+    // Run to frame is handled by OnFrame, so it doesn't need the per-instruction loop.
+    return mPaused || mStepMode != StepMode::None || !mBreakpoints.empty() || !mWatchpoints.empty();
+}
+
+void Debugger::Pause(const std::string& reason)
+{
+    mPaused = true;
+    mBreakReason = reason;
+    mStepMode = StepMode::None;
+    mRunToFrame = 0;
+}
+
+void Debugger::Continue()
+{
+    mPaused = false;
+    mResuming = true;
+    mStepMode = StepMode::None;
+}
+
+void Debugger::StepInto(const Chip& chip)  { BeginStep(chip, StepMode::Into); }
+void Debugger::StepOver(const Chip& chip)  { BeginStep(chip, StepMode::Over); }
+void Debugger::StepOut(const Chip& chip)   { BeginStep(chip, StepMode::Out); }
+
+void Debugger::RunToFrame(uint64_t frame)
+{
+    Continue();
+    mRunToFrame = frame;
+}
+
+void Debugger::BeginStep(const Chip& chip, StepMode mode)
+{
+    mPaused = false;
+    mResuming = true;
+    mStepMode = mode;
+    mStepArmed = false;
+    mStepDepth = chip.mStack.size();
+}
+
+void Debugger::ToggleBreakpoint(uint16_t address)
+{
+    auto it = std::find_if(mBreakpoints.begin(), mBreakpoints.end(),
+                           [address](const Breakpoint& breakpoint) { return breakpoint.mAddress == address; });
+    if (it != mBreakpoints.end())
+    {
+        mBreakpoints.erase(it);
+    }
+    else
+    {
+        mBreakpoints.push_back({ address });
+    }
+}
+
+bool Debugger::HasBreakpoint(uint16_t address) const
+{
+    return std::any_of(mBreakpoints.begin(), mBreakpoints.end(),
+                       [address](const Breakpoint& breakpoint) { return breakpoint.mAddress == address; });
+}
+
+bool Debugger::CheckBreakpoints(const Chip& chip)
+{
+    for (const Breakpoint& breakpoint : mBreakpoints)
+    {
+        if (breakpoint.mAddress != chip.mProgramCounter) { continue; }
+        if (breakpoint.mConditional && !Compare(chip.mVariableRegisters[breakpoint.mRegister], breakpoint.mComparison, breakpoint.mValue)) { continue; }
+
+        char reason[64];
+        snprintf(reason, sizeof(reason), "Breakpoint at 0x%03X", breakpoint.mAddress);
+        Pause(reason);
+        return true;
+    }
+    return false;
+}
+
+bool Debugger::CheckWatchpoints(const Chip& chip)
+{
+    if (mWatchpoints.empty()) { return false; }
+
+    // The access is predicted from the decoded instruction, so we stop before it happens.
+    const Chip::MemoryAccess access = chip.GetMemoryAccess(chip.PeekInstruction());
+    for (uint8_t i = 0; i < access.mLength; ++i)
+    {
+        const uint16_t address = (access.mAddress + i) & (HEAP_SIZE - 1);
+        for (const Watchpoint& watchpoint : mWatchpoints)
+        {
+            if (address < watchpoint.mStart || address > watchpoint.mEnd) { continue; }
+            if (access.mWrite ? !watchpoint.mWrite : !watchpoint.mRead) { continue; }
+
+            char reason[64];
+            snprintf(reason, sizeof(reason), "%s 0x%03X at PC 0x%03X", access.mWrite ? "Write to" : "Read from", address, chip.mProgramCounter);
+            Pause(reason);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Debugger::DrawImGuiMenu(const Chip& chip, uint64_t frame)
+{
+    if (!ImGui::CollapsingHeader("Debugger"))
+    {
+        return;
+    }
+
+    ImGui::Text("Frame: %llu", static_cast<unsigned long long>(frame));
+    if (mPaused)
+    {
+        ImGui::Text("Paused: %s", mBreakReason.c_str());
+        if (ImGui::Button("Continue")) { Continue(); }
+        ImGui::SameLine();
+        if (ImGui::Button("Step")) { StepInto(chip); }
+        ImGui::SameLine();
+        if (ImGui::Button("Step Over")) { StepOver(chip); }
+        ImGui::SameLine();
+        if (ImGui::Button("Step Out")) { StepOut(chip); }
+    }
+    else
+    {
+        ImGui::Text(mRunToFrame != 0 ? "Running to frame %llu" : "Running", static_cast<unsigned long long>(mRunToFrame));
+        if (ImGui::Button("Pause")) { Pause("User"); }
+    }
+
+    ImGui::InputScalar("##RunToFrame", ImGuiDataType_U32, &mRunToFrameInput);
+    ImGui::SameLine();
+    if (ImGui::Button("Run To Frame")) { RunToFrame(mRunToFrameInput); }
+
+    // Call Stack =====================================================================================================
+    ImGui::SeparatorText("Call Stack");
+    auto stack = chip.mStack;
+    if (stack.empty()) { ImGui::TextDisabled("Empty"); }
+    while (!stack.empty())
+    {
+        ImGui::Text("0x%03X", stack.top());
+        stack.pop();
+    }
+
+    // Breakpoints ====================================================================================================
+    ImGui::SeparatorText("Breakpoints");
+    ImGui::InputScalar("Address##Breakpoint", ImGuiDataType_U16, &mNewBreakpointAddress, nullptr, nullptr, "%03X", ImGuiInputTextFlags_CharsHexadecimal);
+    ImGui::Checkbox("Condition", &mNewBreakpointConditional);
+    if (mNewBreakpointConditional)
+    {
+        ImGui::Combo("Register", &mNewBreakpointRegister, gRegisterLabels, 16);
+        ImGui::Combo("Comparison", &mNewBreakpointComparison, gComparisonLabels, 4);
+        ImGui::InputScalar("Value", ImGuiDataType_U8, &mNewBreakpointValue, nullptr, nullptr, "%02X", ImGuiInputTextFlags_CharsHexadecimal);
+    }
+    if (ImGui::Button("Add Breakpoint"))
+    {
+        mBreakpoints.push_back({ mNewBreakpointAddress, mNewBreakpointConditional, static_cast<uint8_t>(mNewBreakpointRegister),
+                                 static_cast<Comparison>(mNewBreakpointComparison), mNewBreakpointValue });
+    }
+
+    for (size_t i = 0; i < mBreakpoints.size(); ++i)
+    {
+        const Breakpoint& breakpoint = mBreakpoints[i];
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::SmallButton("X"))
+        {
+            mBreakpoints.erase(mBreakpoints.begin() + i);
+            ImGui::PopID();
+            break;
+        }
+        ImGui::SameLine();
+        if (breakpoint.mConditional)
+        {
+            ImGui::Text("0x%03X if %s %s 0x%02X", breakpoint.mAddress, gRegisterLabels[breakpoint.mRegister],
+                        gComparisonLabels[static_cast<int>(breakpoint.mComparison)], breakpoint.mValue);
+        }
+        else
+        {
+            ImGui::Text("0x%03X", breakpoint.mAddress);
+        }
+        ImGui::PopID();
+    }
+
+    // Watchpoints ====================================================================================================
+    ImGui::SeparatorText("Watchpoints");
+    ImGui::InputScalar("Start##Watch", ImGuiDataType_U16, &mNewWatchStart, nullptr, nullptr, "%03X", ImGuiInputTextFlags_CharsHexadecimal);
+    ImGui::InputScalar("End##Watch", ImGuiDataType_U16, &mNewWatchEnd, nullptr, nullptr, "%03X", ImGuiInputTextFlags_CharsHexadecimal);
+    ImGui::Checkbox("Read", &mNewWatchRead);
+    ImGui::SameLine();
+    ImGui::Checkbox("Write", &mNewWatchWrite);
+    if (ImGui::Button("Add Watchpoint"))
+    {
+        mWatchpoints.push_back({ std::min(mNewWatchStart, mNewWatchEnd), std::max(mNewWatchStart, mNewWatchEnd), mNewWatchRead, mNewWatchWrite });
+    }
+
+    for (size_t i = 0; i < mWatchpoints.size(); ++i)
+    {
+        const Watchpoint& watchpoint = mWatchpoints[i];
+        ImGui::PushID(static_cast<int>(i + mBreakpoints.size()));
+        if (ImGui::SmallButton("X"))
+        {
+            mWatchpoints.erase(mWatchpoints.begin() + i);
+            ImGui::PopID();
+            break;
+        }
+        ImGui::SameLine();
+        ImGui::Text("0x%03X-0x%03X %s%s", watchpoint.mStart, watchpoint.mEnd, watchpoint.mRead ? "R" : "", watchpoint.mWrite ? "W" : "");
+        ImGui::PopID();
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Chip;
+
+// Breakpoints, watchpoints & stepping on top of Chip::Run<RUN_DEBUG>.
+// Only consulted while IsActive(), otherwise the application runs the undebugged loop.
+class Debugger
+{
+public:
+    enum class Comparison : uint8_t { Equal, NotEqual, Less, Greater };
+
+    struct Breakpoint
+    {
+        uint16_t mAddress = 0;
+        bool mConditional = false; // Only break when V[mRegister] <mComparison> mValue.
+        uint8_t mRegister = 0;
+        Comparison mComparison = Comparison::Equal;
+        uint8_t mValue = 0;
+    };
+
+    struct Watchpoint
+    {
+        uint16_t mStart = 0;
+        uint16_t mEnd = 0; // Inclusive.
+        bool mRead = false;
+        bool mWrite = true;
+    };
+
+    // Called before every instruction by Chip::Run<RUN_DEBUG>, returns true to stop before executing it.
+    bool ShouldBreak(const Chip& chip);
+    void OnFrame(uint64_t frame);
+
+    bool IsActive() const;
+    bool IsPaused() const { return mPaused; }
+    const std::string& GetBreakReason() const { return mBreakReason; }
+
+    void Pause(const std::string& reason);
+    void Continue();
+    void StepInto(const Chip& chip);
+    void StepOver(const Chip& chip);
+    void StepOut(const Chip& chip);
+    void RunToFrame(uint64_t frame);
+
+    void ToggleBreakpoint(uint16_t address);
+    bool HasBreakpoint(uint16_t address) const;
+
+    void DrawImGuiMenu(const Chip& chip, uint64_t frame);
+
+    std::vector<Breakpoint> mBreakpoints;
+    std::vector<Watchpoint> mWatchpoints;
+
+private:
+    enum class StepMode : uint8_t { None, Into, Over, Out };
+
+    void BeginStep(const Chip& chip, StepMode mode);
+    bool CheckBreakpoints(const Chip& chip);
+    bool CheckWatchpoints(const Chip& chip);
+
+    bool mPaused = false;
+    bool mResuming = false; // Ignore breakpoints on the first instruction after resuming.
+    std::string mBreakReason;
+
+    StepMode mStepMode = StepMode::None;
+    bool mStepArmed = false;
+    size_t mStepDepth = 0;
+
+    uint64_t mRunToFrame = 0; // 0 when not running to a frame.
+
+    // ImGui input state.
+    uint16_t mNewBreakpointAddress = 0x200;
+    bool mNewBreakpointConditional = false;
+    int mNewBreakpointRegister = 0;
+    int mNewBreakpointComparison = 0;
+    uint8_t mNewBreakpointValue = 0;
+    uint16_t mNewWatchStart = 0x200;
+    uint16_t mNewWatchEnd = 0x200;
+    bool mNewWatchRead = false;
+    bool mNewWatchWrite = true;
+    uint32_t mRunToFrameInput = 60;
+};
@@ -0,0 +1,768 @@
+#include "FrameCapture.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <imgui.h>
+
+const char* gCaptureFormatLabels[] = { "GIF", "APNG", "Y4M" };
+const char* gCaptureFormatNames[] = { "gif", "apng", "y4m" };
+const char* gCaptureFormatExtensions[] = { ".gif", ".png", ".y4m" };
+
+// Helpers ============================================================================================================
+// LSB first bit packing, the order both GIF LZW & deflate use.
+class BitWriter
+{
+public:
+    void Write(uint32_t bits, int count)
+    {
+        mBuffer |= static_cast<uint64_t>(bits) << mCount;
+        mCount += count;
+        while (mCount >= 8)
+        {
+            mBytes.push_back(static_cast<uint8_t>(mBuffer));
+            mBuffer >>= 8;
+            mCount -= 8;
+        }
+    }
+
+    // Huffman codes are defined most significant bit first.
+    void WriteReversed(uint32_t code, int count)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        Write(reversed, count);
+    }
+
+    void Flush()
+    {
+        if (mCount > 0)
+        {
+            mBytes.push_back(static_cast<uint8_t>(mBuffer));
+        }
+        mBuffer = 0;
+        mCount = 0;
+    }
+
+    std::vector<uint8_t> mBytes;
+
+private:
+    uint64_t mBuffer = 0;
+    int mCount = 0;
+};
+
+static void PutU16BE(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void PutU32BE(std::vector<uint8_t>& out, uint32_t value)
+{
+    PutU16BE(out, value >> 16);
+    PutU16BE(out, value & 0xFFFF);
+}
+
+static void PutU16LE(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+// Smallest bit depth that can index every palette entry, 1-bit for the core's on/off framebuffer.
+static int GetBitDepth(size_t colours)
+{
+    if (colours <= 2)   { return 1; }
+    if (colours <= 4)   { return 2; }
+    if (colours <= 16)  { return 4; }
+    return 8;
+}
+
+struct Rect
+{
+    int mX = 0;
+    int mY = 0;
+    int mWidth = 0;
+    int mHeight = 0;
+};
+
+// Bounding box of pixels that differ from the last written frame, so only that region is encoded.
+static Rect FindChangedRect(const std::vector<uint8_t>& previous, const uint8_t* current, int width, int height)
+{
+    int minX = width, minY = height, maxX = -1, maxY = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* before = &previous[static_cast<size_t>(y) * width];
+        const uint8_t* after = current + static_cast<size_t>(y) * width;
+        if (memcmp(before, after, width) == 0) { continue; }
+
+        for (int x = 0; x < width; ++x)
+        {
+            if (before[x] == after[x]) { continue; }
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+        }
+        minY = std::min(minY, y);
+        maxY = y;
+    }
+
+    // Nothing changed, a single pixel frame still carries the timing.
+    if (maxX < 0) { return { 0, 0, 1, 1 }; }
+    return { minX, minY, maxX - minX + 1, maxY - minY + 1 };
+}
+
+// Deflate ============================================================================================================
+// zlib stream using the fixed Huffman codes & greedy LZ77 matching. Palette frames are mostly long runs & repeated
+// rows, which this catches without building dynamic tables.
+const uint16_t gLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t gLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t gDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                                     4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t gDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+constexpr int DEFLATE_WINDOW = 32768;
+constexpr int DEFLATE_MAX_MATCH = 258;
+constexpr int DEFLATE_MAX_CHAIN = 32;
+constexpr int DEFLATE_HASH_BITS = 15;
+
+static void WriteFixedSymbol(BitWriter& bits, int symbol)
+{
+    if (symbol < 144)       { bits.WriteReversed(0x30 + symbol, 8); }
+    else if (symbol < 256)  { bits.WriteReversed(0x190 + symbol - 144, 9); }
+    else if (symbol < 280)  { bits.WriteReversed(symbol - 256, 7); }
+    else                    { bits.WriteReversed(0xC0 + symbol - 280, 8); }
+}
+
+static void WriteMatch(BitWriter& bits, int length, int distance)
+{
+    int lengthCode = 28;
+    while (gLengthBase[lengthCode] > length) { --lengthCode; }
+    WriteFixedSymbol(bits, 257 + lengthCode);
+    bits.Write(length - gLengthBase[lengthCode], gLengthExtra[lengthCode]);
+
+    int distanceCode = 29;
+    while (gDistanceBase[distanceCode] > distance) { --distanceCode; }
+    bits.WriteReversed(distanceCode, 5);
+    bits.Write(distance - gDistanceBase[distanceCode], gDistanceExtra[distanceCode]);
+}
+
+static std::vector<uint8_t> Deflate(const std::vector<uint8_t>& data)
+{
+    BitWriter bits;
+    bits.mBytes = { 0x78, 0x01 }; // zlib header, 32K window & fastest compression level.
+    bits.Write(1, 1);             // Final block.
+    bits.Write(1, 2);             // Fixed Huffman codes.
+
+    const int size = static_cast<int>(data.size());
+    std::vector<int> head(1 << DEFLATE_HASH_BITS, -1);
+    std::vector<int> previous(data.size(), -1);
+    auto insert = [&](int position)
+    {
+        if (position + 3 > size) { return; }
+        const int hash = ((data[position] << 10) ^ (data[position + 1] << 5) ^ data[position + 2]) & ((1 << DEFLATE_HASH_BITS) - 1);
+        previous[position] = head[hash];
+        head[hash] = position;
+    };
+
+    int i = 0;
+    while (i < size)
+    {
+        int bestLength = 0, bestDistance = 0;
+        if (i + 3 <= size)
+        {
+            const int hash = ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & ((1 << DEFLATE_HASH_BITS) - 1);
+            const int limit = std::min(DEFLATE_MAX_MATCH, size - i);
+            int candidate = head[hash];
+            for (int chain = 0; candidate >= 0 && i - candidate <= DEFLATE_WINDOW && chain < DEFLATE_MAX_CHAIN; ++chain)
+            {
+                int length = 0;
+                while (length < limit && data[candidate + length] == data[i + length]) { ++length; }
+                if (length > bestLength)
+                {
+                    bestLength = length;
+                    bestDistance = i - candidate;
+                    if (length == limit) { break; }
+                }
+                candidate = previous[candidate];
+            }
+        }
+
+        if (bestLength >= 3)
+        {
+            WriteMatch(bits, bestLength, bestDistance);
+            for (int end = i + bestLength; i < end; ++i) { insert(i); }
+        }
+        else
+        {
+            WriteFixedSymbol(bits, data[i]);
+            insert(i++);
+        }
+    }
+    WriteFixedSymbol(bits, 256); // End of block.
+    bits.Flush();
+
+    // Adler-32 of the uncompressed data.
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : data)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    PutU32BE(bits.mBytes, (b << 16) | a);
+    return std::move(bits.mBytes);
+}
+
+static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    static const auto table = []()
+    {
+        std::array<uint32_t, 256> entries;
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) { c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1; }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Writers ============================================================================================================
+class CaptureWriter
+{
+public:
+    virtual ~CaptureWriter() = default;
+
+    virtual void Begin(FILE* file, int width, int height, const std::vector<uint32_t>& palette) = 0;
+    // Frames are palette indices, shown for ticks 60hz frames. last is set for the final frame of the capture.
+    virtual void WriteFrame(const uint8_t* indices, uint64_t ticks, bool last) = 0;
+    virtual void End() = 0;
+
+protected:
+    FILE* mFile = nullptr;
+    int mWidth = 0;
+    int mHeight = 0;
+    std::vector<uint8_t> mPrevious; // Last written frame, starts invalid so the first frame is written whole.
+};
+
+class GifWriter : public CaptureWriter
+{
+public:
+    void Begin(FILE* file, int width, int height, const std::vector<uint32_t>& palette) override
+    {
+        mFile = file;
+        mWidth = width;
+        mHeight = height;
+        mPrevious.assign(static_cast<size_t>(width) * height, 0xFF);
+        mMinCodeSize = std::max(2, GetBitDepth(palette.size())); // GIF's LZW needs at least 2 bits.
+
+        const int tableBits = GetBitDepth(palette.size());
+        std::vector<uint8_t> header = { 'G', 'I', 'F', '8', '9', 'a' };
+        PutU16LE(header, width);
+        PutU16LE(header, height);
+        header.push_back(static_cast<uint8_t>(0x80 | ((tableBits - 1) << 4) | (tableBits - 1))); // Global colour table.
+        header.push_back(0); // Background colour.
+        header.push_back(0); // Square pixels.
+
+        for (size_t i = 0; i < (size_t(1) << tableBits); ++i)
+        {
+            const uint32_t colour = i < palette.size() ? palette[i] : 0;
+            header.push_back(static_cast<uint8_t>(colour >> 24));
+            header.push_back(static_cast<uint8_t>(colour >> 16));
+            header.push_back(static_cast<uint8_t>(colour >> 8));
+        }
+
+        // Loop forever.
+        const uint8_t loop[] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+        header.insert(header.end(), std::begin(loop), std::end(loop));
+        fwrite(header.data(), 1, header.size(), mFile);
+    }
+
+    void WriteFrame(const uint8_t* indices, uint64_t ticks, bool last) override
+    {
+        // Delays are whole centiseconds & viewers treat anything under 2 as 10, so frames are timed against the
+        // rounded capture timeline & any too short to show are folded into the next one.
+        mTicks += ticks;
+        const uint64_t endCentiseconds = (mTicks * 100 + 30) / 60;
+        const uint64_t delay = endCentiseconds - mWrittenCentiseconds;
+        if (delay < 2 && !last) { return; }
+        mWrittenCentiseconds = endCentiseconds;
+
+        const Rect rect = FindChangedRect(mPrevious, indices, mWidth, mHeight);
+        std::vector<uint8_t> block = { 0x21, 0xF9, 0x04, 0x04 }; // Graphic control, keep previous frame underneath.
+        PutU16LE(block, static_cast<uint32_t>(std::min<uint64_t>(delay, 0xFFFF)));
+        block.push_back(0);
+        block.push_back(0);
+
+        block.push_back(0x2C);
+        PutU16LE(block, rect.mX);
+        PutU16LE(block, rect.mY);
+        PutU16LE(block, rect.mWidth);
+        PutU16LE(block, rect.mHeight);
+        block.push_back(0); // No local colour table.
+
+        std::vector<uint8_t> pixels;
+        pixels.reserve(static_cast<size_t>(rect.mWidth) * rect.mHeight);
+        for (int y = rect.mY; y < rect.mY + rect.mHeight; ++y)
+        {
+            const uint8_t* row = indices + static_cast<size_t>(y) * mWidth + rect.mX;
+            pixels.insert(pixels.end(), row, row + rect.mWidth);
+        }
+        WriteImageData(block, pixels);
+        fwrite(block.data(), 1, block.size(), mFile);
+
+        mPrevious.assign(indices, indices + mPrevious.size());
+    }
+
+    void End() override
+    {
+        fputc(0x3B, mFile);
+    }
+
+private:
+    void WriteImageData(std::vector<uint8_t>& out, const std::vector<uint8_t>& pixels)
+    {
+        const uint32_t clearCode = 1u << mMinCodeSize;
+        const uint32_t alphabet = clearCode;
+
+        // children[code * alphabet + index] is the code extending code by index, 0 when not in the dictionary yet.
+        std::vector<uint16_t> children(4096 * alphabet, 0);
+        BitWriter bits;
+        int codeSize = mMinCodeSize + 1;
+        uint32_t maxCode = clearCode + 1;
+        bits.Write(clearCode, codeSize);
+
+        uint32_t current = pixels[0];
+        for (size_t i = 1; i < pixels.size(); ++i)
+        {
+            const uint8_t index = pixels[i];
+            uint16_t& child = children[current * alphabet + index];
+            if (child != 0)
+            {
+                current = child;
+                continue;
+            }
+
+            bits.Write(current, codeSize);
+            child = static_cast<uint16_t>(++maxCode);
+            if (maxCode >= (1u << codeSize)) { codeSize++; }
+            if (maxCode == 4095)
+            {
+                bits.Write(clearCode, codeSize);
+                std::fill(children.begin(), children.end(), 0);
+                codeSize = mMinCodeSize + 1;
+                maxCode = clearCode + 1;
+            }
+            current = index;
+        }
+        bits.Write(current, codeSize);
+
+        // The decoder adds an entry for the last code before reading end of information, widening codes if that
+        // entry crosses a power of two.
+        if (maxCode + 1 >= (1u << codeSize) && codeSize < 12) { codeSize++; }
+        bits.Write(clearCode + 1, codeSize);
+        bits.Flush();
+
+        out.push_back(static_cast<uint8_t>(mMinCodeSize));
+        for (size_t offset = 0; offset < bits.mBytes.size(); offset += 255)
+        {
+            const size_t length = std::min<size_t>(255, bits.mBytes.size() - offset);
+            out.push_back(static_cast<uint8_t>(length));
+            out.insert(out.end(), bits.mBytes.begin() + offset, bits.mBytes.begin() + offset + length);
+        }
+        out.push_back(0);
+    }
+
+    int mMinCodeSize = 2;
+    uint64_t mTicks = 0;
+    uint64_t mWrittenCentiseconds = 0;
+};
+
+class ApngWriter : public CaptureWriter
+{
+public:
+    void Begin(FILE* file, int width, int height, const std::vector<uint32_t>& palette) override
+    {
+        mFile = file;
+        mWidth = width;
+        mHeight = height;
+        mPrevious.assign(static_cast<size_t>(width) * height, 0xFF);
+        mBitDepth = GetBitDepth(palette.size());
+
+        const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        fwrite(signature, 1, sizeof(signature), mFile);
+
+        std::vector<uint8_t> header;
+        PutU32BE(header, width);
+        PutU32BE(header, height);
+        header.push_back(static_cast<uint8_t>(mBitDepth));
+        header.push_back(3); // Indexed colour.
+        header.push_back(0);
+        header.push_back(0);
+        header.push_back(0);
+        WriteChunk("IHDR", header);
+
+        // Frame count isn't known yet, End patches it.
+        mAnimationControlOffset = ftell(mFile);
+        WriteChunk("acTL", AnimationControl());
+
+        std::vector<uint8_t> colours;
+        for (uint32_t colour : palette)
+        {
+            colours.push_back(static_cast<uint8_t>(colour >> 24));
+            colours.push_back(static_cast<uint8_t>(colour >> 16));
+            colours.push_back(static_cast<uint8_t>(colour >> 8));
+        }
+        WriteChunk("PLTE", colours);
+    }
+
+    void WriteFrame(const uint8_t* indices, uint64_t ticks, bool) override
+    {
+        const Rect rect = FindChangedRect(mPrevious, indices, mWidth, mHeight);
+
+        std::vector<uint8_t> control;
+        PutU32BE(control, mSequence++);
+        PutU32BE(control, rect.mWidth);
+        PutU32BE(control, rect.mHeight);
+        PutU32BE(control, rect.mX);
+        PutU32BE(control, rect.mY);
+        if (ticks <= 0xFFFF)
+        {
+            PutU16BE(control, static_cast<uint32_t>(ticks));
+            PutU16BE(control, 60);
+        }
+        else
+        {
+            PutU16BE(control, static_cast<uint32_t>(std::min<uint64_t>(ticks / 60, 0xFFFF)));
+            PutU16BE(control, 1);
+        }
+        control.push_back(0); // Dispose none.
+        control.push_back(0); // Blend source.
+        WriteChunk("fcTL", control);
+
+        // Filter type 0 per row, then indices packed most significant bits first.
+        const size_t rowBytes = (static_cast<size_t>(rect.mWidth) * mBitDepth + 7) / 8;
+        std::vector<uint8_t> scanlines((rowBytes + 1) * rect.mHeight, 0);
+        for (int y = 0; y < rect.mHeight; ++y)
+        {
+            const uint8_t* row = indices + static_cast<size_t>(rect.mY + y) * mWidth + rect.mX;
+            uint8_t* out = &scanlines[y * (rowBytes + 1) + 1];
+            for (int x = 0; x < rect.mWidth; ++x)
+            {
+                const int bit = x * mBitDepth;
+                out[bit / 8] |= static_cast<uint8_t>(row[x] << (8 - mBitDepth - bit % 8));
+            }
+        }
+
+        std::vector<uint8_t> data;
+        if (mFrames == 0)
+        {
+            // The first frame doubles as the default image for viewers without APNG support.
+            data = Deflate(scanlines);
+            WriteChunk("IDAT", data);
+        }
+        else
+        {
+            PutU32BE(data, mSequence++);
+            const std::vector<uint8_t> compressed = Deflate(scanlines);
+            data.insert(data.end(), compressed.begin(), compressed.end());
+            WriteChunk("fdAT", data);
+        }
+
+        mFrames++;
+        mPrevious.assign(indices, indices + mPrevious.size());
+    }
+
+    void End() override
+    {
+        WriteChunk("IEND", {});
+
+        const long end = ftell(mFile);
+        fseek(mFile, mAnimationControlOffset, SEEK_SET);
+        WriteChunk("acTL", AnimationControl());
+        fseek(mFile, end, SEEK_SET);
+    }
+
+private:
+    std::vector<uint8_t> AnimationControl() const
+    {
+        std::vector<uint8_t> control;
+        PutU32BE(control, mFrames);
+        PutU32BE(control, 0); // Loop forever.
+        return control;
+    }
+
+    void WriteChunk(const char* type, const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> chunk;
+        PutU32BE(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        PutU32BE(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+        fwrite(chunk.data(), 1, chunk.size(), mFile);
+    }
+
+    int mBitDepth = 1;
+    uint32_t mSequence = 0;
+    uint32_t mFrames = 0;
+    long mAnimationControlOffset = 0;
+};
+
+class Y4mWriter : public CaptureWriter
+{
+public:
+    void Begin(FILE* file, int width, int height, const std::vector<uint32_t>& palette) override
+    {
+        mFile = file;
+        mWidth = width;
+        mHeight = height;
+        fprintf(mFile, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n", width, height);
+
+        // BT.601 limited range, converted once per palette entry.
+        for (uint32_t colour : palette)
+        {
+            const float r = static_cast<float>(colour >> 24) / 255.f;
+            const float g = static_cast<float>((colour >> 16) & 0xFF) / 255.f;
+            const float b = static_cast<float>((colour >> 8) & 0xFF) / 255.f;
+            mPaletteY.push_back(static_cast<uint8_t>(16.f + 65.481f * r + 128.553f * g + 24.966f * b + 0.5f));
+            mPaletteU.push_back(static_cast<uint8_t>(128.f - 37.797f * r - 74.203f * g + 112.f * b + 0.5f));
+            mPaletteV.push_back(static_cast<uint8_t>(128.f + 112.f * r - 93.786f * g - 18.214f * b + 0.5f));
+        }
+    }
+
+    void WriteFrame(const uint8_t* indices, uint64_t ticks, bool) override
+    {
+        // Constant frame rate, so the frame is converted once & written for every tick it's shown.
+        const size_t pixels = static_cast<size_t>(mWidth) * mHeight;
+        mFrame.resize(6 + pixels * 3);
+        memcpy(mFrame.data(), "FRAME\n", 6);
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            mFrame[6 + i] = mPaletteY[indices[i]];
+            mFrame[6 + pixels + i] = mPaletteU[indices[i]];
+            mFrame[6 + pixels * 2 + i] = mPaletteV[indices[i]];
+        }
+
+        for (uint64_t tick = 0; tick < ticks; ++tick)
+        {
+            fwrite(mFrame.data(), 1, mFrame.size(), mFile);
+        }
+    }
+
+    void End() override {}
+
+private:
+    std::vector<uint8_t> mPaletteY, mPaletteU, mPaletteV;
+    std::vector<uint8_t> mFrame;
+};
+
+// Frame Capture ======================================================================================================
+FrameCapture::FrameCapture() = default;
+
+FrameCapture::~FrameCapture()
+{
+    Stop();
+}
+
+bool FrameCapture::ParseFormat(const std::string& name, CaptureFormat& format)
+{
+    for (size_t i = 0; i < std::size(gCaptureFormatNames); ++i)
+    {
+        if (name == gCaptureFormatNames[i])
+        {
+            format = static_cast<CaptureFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* FrameCapture::GetExtension(CaptureFormat format)
+{
+    return gCaptureFormatExtensions[static_cast<int>(format)];
+}
+
+bool FrameCapture::Start(const std::string& path, CaptureFormat format, int scale)
+{
+    Stop();
+
+    mFile = fopen(path.c_str(), "wb");
+    if (mFile == nullptr)
+    {
+        std::cerr << "Unable to open capture file " << path << std::endl;
+        return false;
+    }
+
+    switch (format)
+    {
+    case CaptureFormat::GIF:    mWriter = std::make_unique<GifWriter>(); break;
+    case CaptureFormat::APNG:   mWriter = std::make_unique<ApngWriter>(); break;
+    case CaptureFormat::Y4M:    mWriter = std::make_unique<Y4mWriter>(); break;
+    }
+
+    mScale = std::max(1, scale);
+    mWriter->Begin(mFile, OUTPUT_WIDTH * mScale, OUTPUT_HEIGHT * mScale, std::vector<uint32_t>(mPalette.begin(), mPalette.end()));
+
+    mHasFrame = false;
+    mTick = 0;
+    mCapturedFrames = 0;
+    mDroppedFrames = 0;
+    mQueue.clear();
+    mStopping = false;
+
+    mEncoder = std::thread(&FrameCapture::EncoderLoop, this);
+    return true;
+}
+
+void FrameCapture::Stop()
+{
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    // Every format needs at least one frame.
+    if (!mHasFrame)
+    {
+        SubmitFrame(Framebuffer{});
+    }
+
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+        mEndTick = mTick;
+    }
+    mCondition.notify_all();
+    mEncoder.join();
+
+    mWriter->End();
+    mWriter.reset();
+    fclose(mFile);
+    mFile = nullptr;
+}
+
+void FrameCapture::SubmitFrame(const Framebuffer& frame, bool waitForSpace)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+
+    const uint64_t tick = mTick++;
+    if (mHasFrame && frame == mLastFrame)
+    {
+        return;
+    }
+
+    {
+        std::unique_lock lock(mMutex);
+        if (waitForSpace)
+        {
+            mCondition.wait(lock, [this]() { return mQueue.size() < MAX_QUEUED_FRAMES; });
+        }
+        else if (mQueue.size() >= MAX_QUEUED_FRAMES)
+        {
+            mDroppedFrames++;
+            return;
+        }
+        mQueue.push_back({ frame, tick });
+    }
+    // Only a queued frame counts as sent, so the next tick retries a dropped change instead of skipping it as a repeat.
+    mLastFrame = frame;
+    mHasFrame = true;
+    mCondition.notify_all();
+    mCapturedFrames++;
+}
+
+// Lit pixels become index 1, scaled up by pixel replication.
+static void ConvertFrame(const FrameCapture::Framebuffer& pixels, int scale, std::vector<uint8_t>& indices)
+{
+    const size_t width = static_cast<size_t>(OUTPUT_WIDTH) * scale;
+    indices.resize(width * OUTPUT_HEIGHT * scale);
+    for (int y = 0; y < OUTPUT_HEIGHT; ++y)
+    {
+        uint8_t* row = &indices[y * scale * width];
+        for (int x = 0; x < OUTPUT_WIDTH; ++x)
+        {
+            std::fill_n(row + x * scale, scale, static_cast<uint8_t>(pixels[y * OUTPUT_WIDTH + x] != 0));
+        }
+        for (int copy = 1; copy < scale; ++copy)
+        {
+            memcpy(row + copy * width, row, width);
+        }
+    }
+}
+
+void FrameCapture::EncoderLoop()
+{
+    // A frame's duration is only known once the next changed frame arrives, so one frame is held back.
+    std::vector<uint8_t> pending, converted;
+    uint64_t pendingTick = 0;
+    bool hasPending = false;
+
+    std::unique_lock lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this]() { return !mQueue.empty() || mStopping; });
+        if (mQueue.empty()) { break; }
+
+        const QueuedFrame frame = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+        mCondition.notify_all(); // Wakes a SubmitFrame waiting for space.
+
+        ConvertFrame(frame.mPixels, mScale, converted);
+        if (hasPending)
+        {
+            mWriter->WriteFrame(pending.data(), frame.mTick - pendingTick, false);
+        }
+        std::swap(pending, converted);
+        pendingTick = frame.mTick;
+        hasPending = true;
+
+        lock.lock();
+    }
+    const uint64_t endTick = mEndTick;
+    lock.unlock();
+
+    if (hasPending)
+    {
+        mWriter->WriteFrame(pending.data(), std::max<uint64_t>(1, endTick - pendingTick), true);
+    }
+}
+
+void FrameCapture::DrawImGuiMenu()
+{
+    if (!ImGui::CollapsingHeader("Capture"))
+    {
+        return;
+    }
+
+    if (IsRecording())
+    {
+        ImGui::Text("Recording to %s", mPathInput);
+        ImGui::Text("%llu frames, %llu dropped", static_cast<unsigned long long>(mCapturedFrames), static_cast<unsigned long long>(mDroppedFrames));
+        if (ImGui::Button("Stop Capture")) { Stop(); }
+        return;
+    }
+
+    if (ImGui::Combo("Format##Capture", &mFormatInput, gCaptureFormatLabels, static_cast<int>(std::size(gCaptureFormatLabels))))
+    {
+        const std::string path = std::filesystem::path(mPathInput).replace_extension(GetExtension(static_cast<CaptureFormat>(mFormatInput))).string();
+        snprintf(mPathInput, sizeof(mPathInput), "%s", path.c_str());
+    }
+    ImGui::InputText("Path##Capture", mPathInput, sizeof(mPathInput));
+    ImGui::SliderInt("Scale##Capture", &mScaleInput, 1, 16);
+    if (ImGui::Button("Start Capture")) { Start(mPathInput, static_cast<CaptureFormat>(mFormatInput), mScaleInput); }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "Chip8.h"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class CaptureFormat : uint8_t
+{
+    GIF,
+    APNG,
+    Y4M,    // Raw 4:4:4 YUV at 60fps, repeated frames are written out in full.
+};
+
+class CaptureWriter;
+
+// Records the core framebuffer to an animation file.
+// SubmitFrame is called once per 60hz frame & only copies the framebuffer when it changed, unchanged frames just
+// lengthen the previous frame. Encoding happens on a background thread, when it falls behind changed frames are
+// dropped unless the caller asks SubmitFrame to wait for queue space (headless tools that must capture every frame).
+class FrameCapture
+{
+public:
+    using Framebuffer = std::array<uint32_t, OUTPUT_WIDTH * OUTPUT_HEIGHT>;
+
+    FrameCapture();
+    ~FrameCapture();
+
+    static bool ParseFormat(const std::string& name, CaptureFormat& format);
+    static const char* GetExtension(CaptureFormat format);
+
+    bool Start(const std::string& path, CaptureFormat format, int scale);
+    void Stop();
+    bool IsRecording() const { return mFile != nullptr; }
+
+    void SubmitFrame(const Framebuffer& frame, bool waitForSpace = false);
+
+    uint64_t GetCapturedFrames() const { return mCapturedFrames; }
+    uint64_t GetDroppedFrames() const { return mDroppedFrames; }
+
+    void DrawImGuiMenu();
+
+    std::array<uint32_t, 2> mPalette = { 0x000000FF, 0xFFFFFFFF }; // RGBA8888 for unlit & lit pixels, read by Start.
+
+private:
+    static constexpr size_t MAX_QUEUED_FRAMES = 600; // Frames are dropped (or SubmitFrame waits) beyond this.
+
+    struct QueuedFrame
+    {
+        Framebuffer mPixels;
+        uint64_t mTick;
+    };
+
+    void EncoderLoop();
+
+    FILE* mFile = nullptr;
+    std::unique_ptr<CaptureWriter> mWriter;
+    int mScale = 1;
+
+    // Emulator thread state.
+    Framebuffer mLastFrame = {}; // Last frame queued for encoding.
+    bool mHasFrame = false;
+    uint64_t mTick = 0;
+    uint64_t mCapturedFrames = 0;
+    uint64_t mDroppedFrames = 0;
+
+    std::thread mEncoder;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<QueuedFrame> mQueue;
+    uint64_t mEndTick = 0; // Set with mStopping, how long the final frame is shown for.
+    bool mStopping = false;
+
+    // ImGui input state.
+    char mPathInput[256] = "capture.gif";
+    int mFormatInput = 0;
+    int mScaleInput = 4;
+};
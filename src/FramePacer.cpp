@@ -0,0 +1,276 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <imgui.h>
+
+const char* gPacingModeLabels[] = { "Uncapped", "VSync", "Adaptive Sleep", "Low Latency" };
+const char* gPacingModeNames[] = { "uncapped", "vsync", "sleep", "latency" };
+
+constexpr uint64_t MIN_SPIN_MARGIN = SDL_NS_PER_MS / 4;
+constexpr uint64_t MAX_SPIN_MARGIN = 4 * SDL_NS_PER_MS;
+
+static float ToMilliseconds(uint64_t nanoseconds)
+{
+    return static_cast<float>(nanoseconds) / SDL_NS_PER_MS;
+}
+
+// Frame Statistics ===================================================================================================
+void FrameStatistics::Add(float milliseconds)
+{
+    mSamples[mNext] = milliseconds;
+    mNext = (mNext + 1) % mSamples.size();
+    mCount = std::min(mCount + 1, mSamples.size());
+}
+
+void FrameStatistics::Clear()
+{
+    mNext = 0;
+    mCount = 0;
+}
+
+float FrameStatistics::GetPercentile(float percentile) const
+{
+    if (mCount == 0) { return 0.f; }
+
+    std::vector<float> sorted(mSamples.begin(), mSamples.begin() + mCount);
+    auto nth = sorted.begin() + std::min(mCount - 1, static_cast<size_t>(percentile * mCount));
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+}
+
+FrameStatistics::Summary FrameStatistics::Summarise() const
+{
+    Summary summary;
+    if (mCount == 0) { return summary; }
+
+    std::vector<float> sorted(mSamples.begin(), mSamples.begin() + mCount);
+    std::sort(sorted.begin(), sorted.end());
+    auto at = [&](float percentile) { return sorted[std::min(mCount - 1, static_cast<size_t>(percentile * mCount))]; };
+    summary.mP50 = at(0.50f);
+    summary.mP95 = at(0.95f);
+    summary.mP99 = at(0.99f);
+    summary.mMax = sorted.back();
+    return summary;
+}
+
+// Frame Pacer ========================================================================================================
+void FramePacer::Init(SDL_Window* window, SDL_Renderer* renderer)
+{
+    mWindow = window;
+    mRenderer = renderer;
+    DetectRefreshRate();
+    mTargetRate = mDisplayRate;
+    SetMode(mMode);
+}
+
+void FramePacer::DetectRefreshRate()
+{
+    const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(mWindow));
+    mDisplayRate = mode != nullptr && mode->refresh_rate > 0.f ? mode->refresh_rate : 60.f;
+}
+
+void FramePacer::SetMode(PacingMode mode)
+{
+    mMode = mode;
+
+    const bool vsync = mode == PacingMode::VSync || mode == PacingMode::LowLatency;
+    if (!SDL_SetRenderVSync(mRenderer, vsync ? 1 : SDL_RENDERER_VSYNC_DISABLED) && vsync)
+    {
+        std::cerr << "VSync unavailable (" << SDL_GetError() << "), falling back to adaptive sleep" << std::endl;
+        mMode = PacingMode::AdaptiveSleep;
+        SDL_SetRenderVSync(mRenderer, SDL_RENDERER_VSYNC_DISABLED);
+    }
+
+    mDeadline = 0;
+    mFrameTimes.Clear();
+    mWorkTimes.Clear();
+    mInputLatency.Clear();
+}
+
+bool FramePacer::ParseMode(const std::string& name, PacingMode& mode)
+{
+    for (size_t i = 0; i < std::size(gPacingModeNames); ++i)
+    {
+        if (name == gPacingModeNames[i])
+        {
+            mode = static_cast<PacingMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t FramePacer::GetFramePeriod() const
+{
+    const float rate = mMode == PacingMode::AdaptiveSleep ? mTargetRate : mDisplayRate;
+    return static_cast<uint64_t>(SDL_NS_PER_SECOND / std::max(rate, 1.f));
+}
+
+void FramePacer::WaitForFrame()
+{
+    const uint64_t period = GetFramePeriod();
+    switch (mMode)
+    {
+    case PacingMode::Uncapped:
+    case PacingMode::VSync:
+        break;
+
+    case PacingMode::AdaptiveSleep:
+    {
+        // Deadlines advance a whole period at a time so pacing doesn't drift, but rebase after falling a frame behind
+        // rather than rushing to catch up.
+        const uint64_t now = SDL_GetTicksNS();
+        if (mDeadline == 0 || now > mDeadline + period)
+        {
+            mDeadline = now;
+        }
+        SleepUntil(mDeadline);
+        mDeadline += period;
+        break;
+    }
+
+    case PacingMode::LowLatency:
+    {
+        // Present returns around the vertical blank, so start the next frame as late as the slowest recent frame
+        // allows & input is sampled as close to the next blank as possible.
+        if (mLastPresent != 0 && mWorkTimes.GetCount() >= 30)
+        {
+            const float budget = mWorkTimes.GetPercentile(0.99f) + mSafetyMargin;
+            const uint64_t budgetNS = static_cast<uint64_t>(budget * SDL_NS_PER_MS);
+            if (budgetNS < period)
+            {
+                SleepUntil(mLastPresent + period - budgetNS);
+            }
+        }
+        break;
+    }
+    }
+
+    mFrameStart = SDL_GetTicksNS();
+}
+
+void FramePacer::SleepUntil(uint64_t target)
+{
+    uint64_t now = SDL_GetTicksNS();
+
+    // Coarse OS sleep for most of the wait, ending early by however late the OS has been waking us recently.
+    if (target > now + mSpinMargin)
+    {
+        const uint64_t requested = target - now - mSpinMargin;
+        SDL_DelayNS(requested);
+
+        const uint64_t woken = SDL_GetTicksNS();
+        const uint64_t oversleep = woken - now > requested ? woken - now - requested : 0;
+        mSpinMargin = std::clamp(std::max(oversleep + oversleep / 4, mSpinMargin - mSpinMargin / 64), MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+        now = woken;
+    }
+
+    while (now < target)
+    {
+        SDL_CPUPauseInstruction();
+        now = SDL_GetTicksNS();
+    }
+}
+
+void FramePacer::OnInput(uint64_t timestamp)
+{
+    if (mPendingInput == 0)
+    {
+        mPendingInput = timestamp;
+    }
+}
+
+void FramePacer::BeforePresent()
+{
+    mWorkTimes.Add(ToMilliseconds(SDL_GetTicksNS() - mFrameStart));
+}
+
+void FramePacer::AfterPresent()
+{
+    const uint64_t now = SDL_GetTicksNS();
+    if (mLastPresent != 0)
+    {
+        mFrameTimes.Add(ToMilliseconds(now - mLastPresent));
+    }
+    mLastPresent = now;
+
+    // Measured to the return of present, so scan-out & display processing are on top of this.
+    if (mPendingInput != 0)
+    {
+        if (now > mPendingInput)
+        {
+            mInputLatency.Add(ToMilliseconds(now - mPendingInput));
+        }
+        mPendingInput = 0;
+    }
+}
+
+void FramePacer::DrawImGuiMenu()
+{
+    if (!ImGui::CollapsingHeader("Frame Pacing"))
+    {
+        return;
+    }
+
+    int mode = static_cast<int>(mMode);
+    if (ImGui::Combo("Mode", &mode, gPacingModeLabels, static_cast<int>(std::size(gPacingModeLabels))))
+    {
+        SetMode(static_cast<PacingMode>(mode));
+    }
+
+    ImGui::Text("Display: %.2f Hz", mDisplayRate);
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Detect")) { DetectRefreshRate(); }
+
+    if (mMode == PacingMode::AdaptiveSleep)
+    {
+        ImGui::SliderFloat("Target FPS", &mTargetRate, 24.f, 240.f, "%.1f");
+        ImGui::Text("Spin margin: %.2f ms", ToMilliseconds(mSpinMargin));
+    }
+    else if (mMode == PacingMode::LowLatency)
+    {
+        ImGui::SliderFloat("Safety Margin", &mSafetyMargin, 0.f, 8.f, "%.1f ms");
+        ImGui::Text("Frame work p99: %.2f ms", mWorkTimes.GetPercentile(0.99f));
+    }
+
+    const FrameStatistics::Summary frame = mFrameTimes.Summarise();
+    ImGui::SeparatorText("Frame Time");
+    ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", frame.mP50, frame.mP95, frame.mP99, frame.mMax);
+    ImGui::PlotLines("##FrameTimes", mFrameTimes.GetSamples(), static_cast<int>(mFrameTimes.GetCount()), mFrameTimes.GetOffset(),
+                     nullptr, 0.f, std::max(frame.mMax, 1000.f / mDisplayRate * 2.f), ImVec2(0, 60));
+
+    const FrameStatistics::Summary latency = mInputLatency.Summarise();
+    ImGui::SeparatorText("Input To Present");
+    if (mInputLatency.GetCount() == 0)
+    {
+        ImGui::TextDisabled("Press a keypad key to sample");
+    }
+    else
+    {
+        ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f ms (%zu presses)", latency.mP50, latency.mP95, latency.mP99, mInputLatency.GetCount());
+    }
+
+    ImGui::Checkbox("Show Overlay", &mShowOverlay);
+}
+
+void FramePacer::DrawOverlay(const ImVec2& position)
+{
+    if (!mShowOverlay)
+    {
+        return;
+    }
+
+    const FrameStatistics::Summary frame = mFrameTimes.Summarise();
+    const FrameStatistics::Summary latency = mInputLatency.Summarise();
+
+    ImGui::SetNextWindowPos(position, ImGuiCond_Always);
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    ImGui::Begin("Frame Pacing Overlay", nullptr,
+                 ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoInputs |
+                 ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+    ImGui::Text("%s", gPacingModeLabels[static_cast<int>(mMode)]);
+    ImGui::Text("Frame p50 %.2f p99 %.2f ms", frame.mP50, frame.mP99);
+    ImGui::Text("Input p50 %.2f p99 %.2f ms", latency.mP50, latency.mP99);
+    ImGui::End();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <imgui.h>
+#include <string>
+#include <vector>
+
+enum class PacingMode : uint8_t
+{
+    Uncapped,       // Run as fast as possible, useful for benchmarking only.
+    VSync,          // Present blocks on the display's vertical blank.
+    AdaptiveSleep,  // No vsync, sleep toward a fixed frame deadline.
+    LowLatency,     // VSync, but delay emulation until just before the next vertical blank.
+};
+
+// Rolling window of millisecond samples, summarised as percentiles for display.
+class FrameStatistics
+{
+public:
+    struct Summary
+    {
+        float mP50 = 0.f;
+        float mP95 = 0.f;
+        float mP99 = 0.f;
+        float mMax = 0.f;
+    };
+
+    explicit FrameStatistics(size_t capacity) : mSamples(capacity, 0.f) {}
+
+    void Add(float milliseconds);
+    void Clear();
+
+    size_t GetCount() const { return mCount; }
+    float GetPercentile(float percentile) const;
+    Summary Summarise() const;
+
+    // Oldest sample first when drawn with ImGui::PlotLines(..., GetCount(), GetOffset()).
+    const float* GetSamples() const { return mSamples.data(); }
+    int GetOffset() const { return mCount < mSamples.size() ? 0 : static_cast<int>(mNext); }
+
+private:
+    std::vector<float> mSamples;
+    size_t mNext = 0;
+    size_t mCount = 0;
+};
+
+// Decides when each frame starts & records frame-time & input-to-photon statistics.
+// Frame loop order: WaitForFrame, poll input (OnInput per key press), emulate, render, BeforePresent, present, AfterPresent.
+class FramePacer
+{
+public:
+    void Init(SDL_Window* window, SDL_Renderer* renderer);
+
+    void SetMode(PacingMode mode);
+    PacingMode GetMode() const { return mMode; }
+    static bool ParseMode(const std::string& name, PacingMode& mode);
+
+    void WaitForFrame();
+    void OnInput(uint64_t timestamp); // SDL event timestamp, in SDL_GetTicksNS time.
+    void BeforePresent();
+    void AfterPresent();
+
+    void DrawImGuiMenu();
+    void DrawOverlay(const ImVec2& position);
+
+private:
+    uint64_t GetFramePeriod() const;
+    void SleepUntil(uint64_t target);
+    void DetectRefreshRate();
+
+    SDL_Window* mWindow = nullptr;
+    SDL_Renderer* mRenderer = nullptr;
+    PacingMode mMode = PacingMode::VSync;
+
+    float mDisplayRate = 60.f;  // Refresh rate reported by the display.
+    float mTargetRate = 60.f;   // Frame rate targeted by AdaptiveSleep.
+    float mSafetyMargin = 1.f;  // LowLatency slack in milliseconds on top of the worst recent frame work.
+
+    uint64_t mDeadline = 0;     // Next AdaptiveSleep frame start.
+    uint64_t mFrameStart = 0;
+    uint64_t mLastPresent = 0;
+    uint64_t mPendingInput = 0; // Earliest input not yet presented, 0 if none.
+
+    // OS sleeps are ended this early & the remainder spun, grown by late wake ups & slowly decayed.
+    uint64_t mSpinMargin = 1 * SDL_NS_PER_MS;
+
+    FrameStatistics mFrameTimes = FrameStatistics(240);
+    FrameStatistics mWorkTimes = FrameStatistics(240);
+    FrameStatistics mInputLatency = FrameStatistics(64);
+
+    bool mShowOverlay = false;
+};
@@ -0,0 +1,147 @@
+#include "MemoryViewer.h"
+#include <algorithm>
+#include <cstring>
+#include <stack>
+#include <imgui.h>
+
+void MemoryViewer::Reset(const Chip& chip)
+{
+    mSnapshot = chip.mHeap;
+    mChangedFrame.fill(0);
+    mSeenGeneration = chip.GetHeapGeneration();
+    mIndexRegister = chip.mIndexRegister;
+    mIndexChangedFrame = 0;
+    mPagesDiffed = 0;
+}
+
+void MemoryViewer::OnFrame(const Chip& chip, uint64_t frame)
+{
+    mFrame = frame;
+    if (chip.mIndexRegister != mIndexRegister)
+    {
+        mIndexRegister = chip.mIndexRegister;
+        mIndexChangedFrame = frame;
+    }
+
+    const uint32_t generation = chip.GetHeapGeneration();
+    mPagesDiffed = 0;
+    if (generation == mSeenGeneration)
+    {
+        return;
+    }
+
+    for (size_t page = 0; page < Chip::HEAP_PAGES; ++page)
+    {
+        // Generations are compared by distance so the counter wrapping doesn't matter.
+        if (static_cast<int32_t>(chip.GetPageGeneration(page) - mSeenGeneration) <= 0)
+        {
+            continue;
+        }
+
+        const size_t start = page * Chip::HEAP_PAGE_SIZE;
+        mPagesDiffed++;
+        if (memcmp(&mSnapshot[start], &chip.mHeap[start], Chip::HEAP_PAGE_SIZE) == 0)
+        {
+            continue;
+        }
+
+        for (size_t address = start; address < start + Chip::HEAP_PAGE_SIZE; ++address)
+        {
+            if (mSnapshot[address] != chip.mHeap[address])
+            {
+                mSnapshot[address] = chip.mHeap[address];
+                mChangedFrame[address] = frame;
+            }
+        }
+    }
+    mSeenGeneration = generation;
+}
+
+void MemoryViewer::DrawImGuiMenu(const Chip& chip)
+{
+    if (!ImGui::CollapsingHeader("Memory"))
+    {
+        return;
+    }
+
+    const ImVec4 normal = ImGui::GetStyleColorVec4(ImGuiCol_Text);
+    const ImVec4 changed = ImVec4(1.f, 0.8f, 0.2f, 1.f);
+    auto highlight = [&](uint64_t changedFrame)
+    {
+        // Fades from the highlight back to the text colour over HIGHLIGHT_FRAMES.
+        const uint64_t age = mFrame - changedFrame;
+        if (changedFrame == 0 || age >= HIGHLIGHT_FRAMES) { return normal; }
+        const float t = static_cast<float>(age) / HIGHLIGHT_FRAMES;
+        return ImVec4(changed.x + (normal.x - changed.x) * t, changed.y + (normal.y - changed.y) * t,
+                      changed.z + (normal.z - changed.z) * t, 1.f);
+    };
+
+    ImGui::TextColored(highlight(mIndexChangedFrame), "I: 0x%03X", chip.mIndexRegister);
+    ImGui::SameLine();
+    ImGui::Text("  Delay: %3u  Sound: %3u", chip.mDelayTimer, chip.mSoundTimer);
+
+    // std::stack can't be iterated, a copy is cheap at CHIP-8 stack depths.
+    std::stack<uint16_t> stack = chip.mStack;
+    ImGui::Text("Stack (%zu):", stack.size());
+    while (!stack.empty())
+    {
+        ImGui::SameLine();
+        ImGui::Text("%03X", stack.top());
+        stack.pop();
+    }
+    ImGui::Text("%zu of %zu pages diffed last frame", mPagesDiffed, Chip::HEAP_PAGES);
+
+    ImGui::SetNextItemWidth(80.f);
+    if (ImGui::InputInt("##GotoAddress", &mGotoAddress, 0, 0, ImGuiInputTextFlags_CharsHexadecimal | ImGuiInputTextFlags_EnterReturnsTrue))
+    {
+        mScrollToAddress = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Go To")) { mScrollToAddress = true; }
+    ImGui::SameLine();
+    ImGui::Checkbox("Follow I", &mFollowIndex);
+
+    const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+    ImGui::BeginChild("MemoryListing", ImVec2(0, lineHeight * 24), ImGuiChildFlags_Borders);
+
+    if (mFollowIndex)
+    {
+        mGotoAddress = chip.mIndexRegister;
+        mScrollToAddress = true;
+    }
+    if (mScrollToAddress)
+    {
+        mGotoAddress = std::clamp(mGotoAddress, 0, HEAP_SIZE - 1);
+        ImGui::SetScrollY(std::max(0.f, (mGotoAddress / BYTES_PER_ROW - 8) * lineHeight));
+        mScrollToAddress = false;
+    }
+
+    // Only the visible rows are submitted, so the heap size doesn't matter.
+    ImGuiListClipper clipper;
+    clipper.Begin(HEAP_SIZE / BYTES_PER_ROW, lineHeight);
+    while (clipper.Step())
+    {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+        {
+            const int start = row * BYTES_PER_ROW;
+            ImGui::TextDisabled("%03X", start);
+            for (int address = start; address < start + BYTES_PER_ROW; ++address)
+            {
+                ImGui::SameLine(0.f, address % 8 == 0 ? 12.f : -1.f);
+
+                // I & the program counter are boxed so it's clear what the next instruction reads.
+                const bool atIndex = address == chip.mIndexRegister;
+                const bool atProgramCounter = address == chip.mProgramCounter || address == chip.mProgramCounter + 1;
+                if (atIndex || atProgramCounter)
+                {
+                    const ImVec2 min = ImGui::GetCursorScreenPos();
+                    const ImVec2 size = ImGui::CalcTextSize("00");
+                    ImGui::GetWindowDrawList()->AddRect(min, ImVec2(min.x + size.x, min.y + size.y),
+                                                        atIndex ? IM_COL32(90, 200, 255, 255) : IM_COL32(120, 230, 120, 255));
+                }
+                ImGui::TextColored(highlight(mChangedFrame[address]), "%02X", chip.mHeap[address]);
+            }
+        }
+    }
+    ImGui::EndChild();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "Chip8.h"
+
+// Hex view of the whole heap plus I, the stack & timers, highlighting bytes that changed recently.
+// OnFrame only compares pages the core has stamped with a newer write generation, so an idle heap costs a scan of
+// the page generations rather than a diff of every byte.
+class MemoryViewer
+{
+public:
+    // Takes a fresh snapshot, call after the emulator is replaced or reloaded.
+    void Reset(const Chip& chip);
+    // Call once per 60hz frame.
+    void OnFrame(const Chip& chip, uint64_t frame);
+
+    void DrawImGuiMenu(const Chip& chip);
+
+private:
+    static constexpr int BYTES_PER_ROW = 16;
+    static constexpr uint64_t HIGHLIGHT_FRAMES = 30; // Frames a changed byte takes to fade back to normal.
+
+    std::array<uint8_t, HEAP_SIZE> mSnapshot = {};
+    std::array<uint64_t, HEAP_SIZE> mChangedFrame = {}; // Frame each byte last changed on, 0 if never.
+    uint32_t mSeenGeneration = 0;
+    uint64_t mFrame = 0;
+    size_t mPagesDiffed = 0; // Pages compared by the last OnFrame.
+
+    // Register state at the previous frame, for highlighting.
+    uint16_t mIndexRegister = 0;
+    uint64_t mIndexChangedFrame = 0;
+
+    int mGotoAddress = 0x200;
+    bool mScrollToAddress = false;
+    bool mFollowIndex = false;
+};
@@ -64,6 +64,29 @@ void QuirkStorage::SaveConfig(const std::string& romPath)
     outFile << configJson.dump(4);  // Pretty-print with 4-space indent
 }
 
+bool QuirkStorage::ReadConfig(const std::string& romPath, const std::string& configPath)
+{
+    std::string romName = fs::path(romPath).filename().string();
+    
+    ResetToDefault();
+
+    std::ifstream file(configPath);
+    if (!file) {
+        return false;
+    }
+    
+    json configJson = json::parse(file, nullptr, false);
+    if (configJson.is_discarded() || !configJson.contains(romName)) {
+        return false;
+    }
+
+    auto& quirks = configJson[romName];
+    mModernShift            = quirks.value("ModernShiftQuirk", false);
+    mModernLoadStore        = quirks.value("ModernLoadStoreQuirk", false);
+    mSuperChipJump          = quirks.value("JumpQuirk", false);
+    return true;
+}
+
 void QuirkStorage::ResetToDefault()
 {
     mModernShift        = false;
@@ -71,12 +94,28 @@ void QuirkStorage::ResetToDefault()
     mSuperChipJump      = false;
 }
 
-void QuirkStorage::DrawImGuiMenu()
+uint8_t QuirkStorage::GetFlags() const
+{
+    return (mModernShift ? QUIRK_MODERN_SHIFT : 0) |
+           (mModernLoadStore ? QUIRK_MODERN_LOAD_STORE : 0) |
+           (mSuperChipJump ? QUIRK_SUPER_CHIP_JUMP : 0);
+}
+
+void QuirkStorage::SetFlags(uint8_t flags)
+{
+    mModernShift        = flags & QUIRK_MODERN_SHIFT;
+    mModernLoadStore    = flags & QUIRK_MODERN_LOAD_STORE;
+    mSuperChipJump      = flags & QUIRK_SUPER_CHIP_JUMP;
+}
+
+bool QuirkStorage::DrawImGuiMenu()
 {
+    bool changed = false;
     if (ImGui::CollapsingHeader("Quirks"))
     {
-        ImGui::Checkbox("Modern Shift modifies VX",         &mModernShift);
-        ImGui::Checkbox("Modern Load/Store (FX55/FX65)",    &mModernLoadStore);
-        ImGui::Checkbox("Jump with offset uses V0",         &mSuperChipJump);
+        changed |= ImGui::Checkbox("Modern Shift modifies VX",         &mModernShift);
+        changed |= ImGui::Checkbox("Modern Load/Store (FX55/FX65)",    &mModernLoadStore);
+        changed |= ImGui::Checkbox("Jump with offset uses V0",         &mSuperChipJump);
     }
+    return changed;
 }
\ No newline at end of file
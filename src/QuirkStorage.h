@@ -1,14 +1,28 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
+// Bit flags for each quirk, used to enumerate and compare quirk combinations.
+enum QuirkFlags : uint8_t
+{
+    QUIRK_MODERN_SHIFT              = 1 << 0,
+    QUIRK_MODERN_LOAD_STORE         = 1 << 1,
+    QUIRK_SUPER_CHIP_JUMP           = 1 << 2,
+};
+constexpr uint8_t QUIRK_COMBINATIONS = 1 << 3;
+
 class QuirkStorage
 {
 public:
     void LoadConfig(const std::string& romPath);
     void SaveConfig(const std::string& romPath);
+    bool ReadConfig(const std::string& romPath, const std::string& configPath); // Read-only, safe to call concurrently.
 
     void ResetToDefault();
-    void DrawImGuiMenu();
+    bool DrawImGuiMenu(); // Returns true if a quirk was toggled.
+
+    uint8_t GetFlags() const;
+    void SetFlags(uint8_t flags);
     
     // Quirks ==========================================================================================================
     bool mModernShift               = false;
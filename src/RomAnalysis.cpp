@@ -0,0 +1,372 @@
+#include "RomAnalysis.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+// Mnemonics share the names of the Chip::Op_* handlers they execute.
+const std::array<std::pair<uint16_t, const char*>, 34> gMnemonics = {{
+    {0x00E0, "ClearScreen"},
+    {0x00EE, "PopSubroutine"},
+    {0x1000, "Jump"},
+    {0x2000, "PushSubroutine"},
+    {0x3000, "SkipIfVxNnEqual"},
+    {0x4000, "SkipIfVxNnNotEqual"},
+    {0x5000, "SkipIfVxVyEqual"},
+    {0x6000, "SetVxToNn"},
+    {0x7000, "AddNnToVx"},
+    {0x8000, "SetVxToVy"},
+    {0x8001, "BinaryOR"},
+    {0x8002, "BinaryAND"},
+    {0x8003, "LogicalXOR"},
+    {0x8004, "AddWithCarry"},
+    {0x8005, "SubtractVyFromVx"},
+    {0x8006, "ShiftRight"},
+    {0x8007, "SubtractVxfromVy"},
+    {0x800E, "ShiftLeft"},
+    {0x9000, "SkipIfVxVyNotEqual"},
+    {0xA000, "SetIndexRegister"},
+    {0xB000, "JumpWithOffset"},
+    {0xC000, "Random"},
+    {0xD000, "Draw"},
+    {0xE09E, "SkipIfKeyPressed"},
+    {0xE0A1, "SkipIfKeyNotPressed"},
+    {0xF007, "CacheDelayTimer"},
+    {0xF00A, "GetKey"},
+    {0xF015, "SetDelayTimer"},
+    {0xF018, "SetSoundTimer"},
+    {0xF01E, "AddToIndexRegister"},
+    {0xF029, "SetFontCharacter"},
+    {0xF033, "BinaryToDecimal"},
+    {0xF055, "StoreMemory"},
+    {0xF065, "LoadMemory"},
+}};
+
+// Largest sprite DXYN can draw, used to bound data regions referenced by ANNN.
+constexpr uint16_t MAX_SPRITE_BYTES = 15;
+
+static bool IsSkip(uint16_t opcode)
+{
+    const uint8_t group = opcode >> 12;
+    return group == 0x3 || group == 0x4 || group == 0x5 || group == 0x9 || opcode == 0xE09E || opcode == 0xE0A1;
+}
+
+static uint64_t HashRom(const uint8_t* rom, size_t size)
+{
+    // FNV-1a, seeded with the size so zero padding still changes the hash.
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ rom[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::shared_ptr<const RomAnalysis> RomAnalysis::Analyse(const uint8_t* rom, size_t size)
+{
+    static std::mutex gCacheMutex;
+    static std::unordered_map<uint64_t, std::shared_ptr<const RomAnalysis>> gCache;
+
+    const uint64_t hash = HashRom(rom, size);
+    {
+        std::lock_guard lock(gCacheMutex);
+        if (auto it = gCache.find(hash); it != gCache.end())
+        {
+            return it->second;
+        }
+    }
+
+    auto analysis = std::make_shared<RomAnalysis>();
+    analysis->mHash = hash;
+    analysis->Build(rom, size);
+
+    std::lock_guard lock(gCacheMutex);
+    return gCache.emplace(hash, std::move(analysis)).first->second;
+}
+
+const char* RomAnalysis::GetMnemonic(uint16_t opcode)
+{
+    for (const auto& [key, name] : gMnemonics)
+    {
+        if (key == opcode) { return name; }
+    }
+    return nullptr;
+}
+
+std::string RomAnalysis::Disassemble(uint16_t instruction)
+{
+    const char* mnemonic = GetMnemonic(Chip::DecodeInstruction(instruction));
+    if (mnemonic == nullptr) { return "Unknown"; }
+
+    const uint8_t x = (instruction >> 8) & 0xF;
+    const uint8_t y = (instruction >> 4) & 0xF;
+
+    char buffer[64];
+    switch (instruction >> 12)
+    {
+    case 0x0:
+        return mnemonic;
+    case 0x1: case 0x2: case 0xA: case 0xB:
+        snprintf(buffer, sizeof(buffer), "%s 0x%03X", mnemonic, instruction & 0xFFF);
+        break;
+    case 0x3: case 0x4: case 0x6: case 0x7: case 0xC:
+        snprintf(buffer, sizeof(buffer), "%s V%X, 0x%02X", mnemonic, x, instruction & 0xFF);
+        break;
+    case 0x5: case 0x8: case 0x9:
+        snprintf(buffer, sizeof(buffer), "%s V%X, V%X", mnemonic, x, y);
+        break;
+    case 0xD:
+        snprintf(buffer, sizeof(buffer), "%s V%X, V%X, %d", mnemonic, x, y, instruction & 0xF);
+        break;
+    default:
+        snprintf(buffer, sizeof(buffer), "%s V%X", mnemonic, x);
+        break;
+    }
+    return buffer;
+}
+
+const RomAnalysis::BasicBlock* RomAnalysis::FindBlock(uint16_t address) const
+{
+    auto it = std::lower_bound(mBlocks.begin(), mBlocks.end(), address,
+                               [](const BasicBlock& block, uint16_t start) { return block.mStart < start; });
+    return (it != mBlocks.end() && it->mStart == address) ? &*it : nullptr;
+}
+
+int RomAnalysis::FindListingLine(uint16_t address) const
+{
+    return mLineByAddress[address & (HEAP_SIZE - 1)];
+}
+
+void RomAnalysis::Build(const uint8_t* rom, size_t size)
+{
+    constexpr uint16_t START = 0x200;
+    mRomSize = std::min<size_t>(size, HEAP_SIZE - START);
+    const uint16_t end = static_cast<uint16_t>(START + mRomSize);
+
+    auto inRom = [&](uint32_t address) { return address >= START && address + 1 < end; };
+    auto read = [&](uint16_t address) { return static_cast<uint16_t>((rom[address - START] << 8) | rom[address - START + 1]); };
+
+    // Pass 1: recursive traversal from the entry point, finding reachable instructions & block leaders.
+    std::bitset<HEAP_SIZE> visited;
+    std::bitset<HEAP_SIZE> leaders;
+    std::vector<uint16_t> entries = { START };
+    std::vector<uint16_t> worklist = { START };
+    leaders.set(START);
+
+    while (!worklist.empty())
+    {
+        uint16_t address = worklist.back();
+        worklist.pop_back();
+
+        while (inRom(address) && !visited[address])
+        {
+            visited.set(address);
+            mByteKinds[address] = mByteKinds[address + 1] = ByteKind::Code;
+
+            const uint16_t instruction = read(address);
+            const uint16_t opcode = Chip::DecodeInstruction(instruction);
+            const uint16_t nnn = instruction & 0xFFF;
+
+            if (opcode == 0x00EE || opcode == 0xB000) { break; }
+            if (opcode == 0x1000)
+            {
+                leaders.set(nnn);
+                worklist.push_back(nnn);
+                break;
+            }
+            if (opcode == 0x2000)
+            {
+                leaders.set(nnn);
+                worklist.push_back(nnn);
+                if (std::find(entries.begin(), entries.end(), nnn) == entries.end()) { entries.push_back(nnn); }
+                leaders.set(address + 2);
+            }
+            if (IsSkip(opcode))
+            {
+                leaders.set(address + 2);
+                leaders.set(address + 4);
+                worklist.push_back(address + 2);
+                worklist.push_back(address + 4);
+                break;
+            }
+            address += 2;
+        }
+
+        // Falling into already traversed code makes a merge point.
+        if (inRom(address) && visited[address]) { leaders.set(address); }
+    }
+
+    // ANNN targets that aren't code are data, most likely sprites.
+    for (uint16_t address = START; inRom(address); ++address)
+    {
+        if (!visited[address] || (read(address) >> 12) != 0xA) { continue; }
+
+        const uint16_t target = read(address) & 0xFFF;
+        for (uint16_t i = target; i < end && i < target + MAX_SPRITE_BYTES && mByteKinds[i] != ByteKind::Code; ++i)
+        {
+            mByteKinds[i] = ByteKind::Data;
+        }
+    }
+
+    // Pass 2: split reachable instructions into basic blocks.
+    for (uint16_t start = START; start < end; ++start)
+    {
+        if (!leaders[start] || !visited[start]) { continue; }
+
+        BasicBlock block;
+        block.mStart = start;
+        for (uint16_t address = start; ; address += 2)
+        {
+            const uint16_t instruction = read(address);
+            const uint16_t opcode = Chip::DecodeInstruction(instruction);
+            block.mInstructions.push_back({ address, instruction, opcode });
+            block.mEnd = address + 2;
+
+            if (opcode == 0x00EE) { break; }
+            if (opcode == 0xB000) { block.mIndirectJump = true; break; }
+            if (opcode == 0x1000) { block.mSuccessors.push_back(instruction & 0xFFF); break; }
+            if (IsSkip(opcode))
+            {
+                block.mSuccessors.push_back(address + 2);
+                block.mSuccessors.push_back(address + 4);
+                break;
+            }
+
+            const uint16_t next = address + 2;
+            if (!visited[next]) { break; }
+            if (leaders[next])
+            {
+                block.mSuccessors.push_back(next);
+                break;
+            }
+        }
+        mBlocks.push_back(std::move(block));
+    }
+
+    // Assign blocks to subroutines, following intra-procedural edges only. Main (0x200) claims first.
+    for (uint16_t entry : entries)
+    {
+        if (FindBlock(entry) == nullptr) { continue; }
+
+        Subroutine subroutine;
+        subroutine.mEntry = entry;
+
+        std::vector<uint16_t> pending = { entry };
+        while (!pending.empty())
+        {
+            const uint16_t start = pending.back();
+            pending.pop_back();
+
+            auto* block = const_cast<BasicBlock*>(FindBlock(start));
+            if (block == nullptr || block->mSubroutine != 0) { continue; }
+
+            block->mSubroutine = entry;
+            subroutine.mBlocks.push_back(start);
+            pending.insert(pending.end(), block->mSuccessors.begin(), block->mSuccessors.end());
+        }
+
+        std::sort(subroutine.mBlocks.begin(), subroutine.mBlocks.end());
+        mSubroutines.push_back(std::move(subroutine));
+    }
+
+    FindSelfModifyingWrites();
+    BuildListing(rom);
+}
+
+void RomAnalysis::FindSelfModifyingWrites()
+{
+    // Track I through each block when it's set from a constant, writes into code through a known I are flagged.
+    for (const BasicBlock& block : mBlocks)
+    {
+        int32_t index = -1; // Unknown.
+
+        for (const Instruction& instruction : block.mInstructions)
+        {
+            const uint8_t x = (instruction.mInstruction >> 8) & 0xF;
+            uint16_t writeLength = 0;
+
+            switch (instruction.mOpcode)
+            {
+            case 0xA000: index = instruction.mInstruction & 0xFFF; break;
+            case 0xF01E: index = -1; break;
+            case 0xF029: index = -1; break;
+            case 0xF033: writeLength = 3; break;
+            case 0xF055: writeLength = x + 1; break;
+            case 0xF065: index = -1; break; // I may advance, depending on quirks.
+            default: break;
+            }
+
+            if (writeLength == 0 || index < 0) { continue; }
+
+            for (uint16_t i = 0; i < writeLength; ++i)
+            {
+                const uint16_t target = (index + i) & (HEAP_SIZE - 1);
+                if (mByteKinds[target] == ByteKind::Code)
+                {
+                    mSelfModifyingWrites.push_back({ instruction.mAddress, target });
+                    break;
+                }
+            }
+
+            if (instruction.mOpcode == 0xF055) { index = -1; }
+        }
+    }
+}
+
+void RomAnalysis::BuildListing(const uint8_t* rom)
+{
+    constexpr uint16_t START = 0x200;
+    constexpr uint16_t BYTES_PER_DATA_LINE = 8;
+    const uint16_t end = static_cast<uint16_t>(START + mRomSize);
+
+    mLineByAddress.fill(-1);
+
+    auto isSelfModifying = [&](uint16_t address) {
+        return std::any_of(mSelfModifyingWrites.begin(), mSelfModifyingWrites.end(),
+                           [&](const SelfModifyingWrite& write) { return write.mAddress == address; });
+    };
+
+    auto emitData = [&](uint16_t from, uint16_t to) {
+        while (from < to)
+        {
+            const ByteKind kind = mByteKinds[from];
+            ListingLine line;
+            line.mAddress = from;
+            line.mKind = kind;
+
+            char buffer[64];
+            int length = snprintf(buffer, sizeof(buffer), "0x%03X  ", from);
+            for (uint16_t i = 0; i < BYTES_PER_DATA_LINE && from < to && mByteKinds[from] == kind; ++i, ++from)
+            {
+                mLineByAddress[from] = static_cast<int32_t>(mListing.size());
+                length += snprintf(buffer + length, sizeof(buffer) - length, "%02X ", rom[from - START]);
+            }
+            line.mText = buffer;
+            mListing.push_back(std::move(line));
+        }
+    };
+
+    uint16_t position = START;
+    for (const BasicBlock& block : mBlocks)
+    {
+        if (block.mStart > position) { emitData(position, block.mStart); }
+
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%s_%03X:", block.mSubroutine == block.mStart ? "sub" : "loc", block.mStart);
+        mListing.push_back({ block.mStart, buffer, ByteKind::Code, true, false });
+
+        for (const Instruction& instruction : block.mInstructions)
+        {
+            const bool selfModifying = isSelfModifying(instruction.mAddress);
+            snprintf(buffer, sizeof(buffer), "0x%03X  %04X  ", instruction.mAddress, instruction.mInstruction);
+
+            mLineByAddress[instruction.mAddress] = static_cast<int32_t>(mListing.size());
+            mListing.push_back({ instruction.mAddress, buffer + Disassemble(instruction.mInstruction) + (selfModifying ? "  ; writes code" : ""),
+                                 ByteKind::Code, false, selfModifying });
+        }
+        position = std::max(position, block.mEnd);
+    }
+
+    if (position < end) { emitData(position, end); }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Chip8.h"
+
+// Static analysis of a ROM image: disassembly, basic blocks, subroutines & code/data classification.
+// Results are immutable & cached per ROM hash so the UI and any predecoding engine share one analysis.
+class RomAnalysis
+{
+public:
+    enum class ByteKind : uint8_t
+    {
+        Unknown,    // Never reached by static traversal.
+        Code,
+        Data,       // Referenced through ANNN.
+    };
+
+    struct Instruction
+    {
+        uint16_t mAddress = 0;
+        uint16_t mInstruction = 0;  // Raw 16-bit instruction.
+        uint16_t mOpcode = 0;       // Masked binding key, as returned by Chip::DecodeInstruction.
+    };
+
+    struct BasicBlock
+    {
+        uint16_t mStart = 0;
+        uint16_t mEnd = 0; // Exclusive.
+        std::vector<Instruction> mInstructions;
+        std::vector<uint16_t> mSuccessors;
+        uint16_t mSubroutine = 0; // Entry of the owning subroutine.
+        bool mIndirectJump = false; // Ends in BNNN, successors are unknown.
+    };
+
+    struct Subroutine
+    {
+        uint16_t mEntry = 0;
+        std::vector<uint16_t> mBlocks; // Block start addresses.
+    };
+
+    struct SelfModifyingWrite
+    {
+        uint16_t mAddress = 0;  // Address of the writing instruction.
+        uint16_t mTarget = 0;   // First code byte written.
+    };
+
+    struct ListingLine
+    {
+        uint16_t mAddress = 0;
+        std::string mText;
+        ByteKind mKind = ByteKind::Unknown;
+        bool mLabel = false;
+        bool mSelfModifying = false;
+    };
+
+    // Returns the cached analysis for this ROM image, analysing it on first use.
+    static std::shared_ptr<const RomAnalysis> Analyse(const uint8_t* rom, size_t size);
+
+    static const char* GetMnemonic(uint16_t opcode);
+    static std::string Disassemble(uint16_t instruction);
+
+    const BasicBlock* FindBlock(uint16_t address) const; // Block starting at address, or null.
+    int FindListingLine(uint16_t address) const; // -1 if the address has no line of its own.
+
+    uint64_t mHash = 0;
+    size_t mRomSize = 0;
+    std::vector<BasicBlock> mBlocks; // Sorted by start address.
+    std::vector<Subroutine> mSubroutines;
+    std::vector<SelfModifyingWrite> mSelfModifyingWrites;
+    std::array<ByteKind, HEAP_SIZE> mByteKinds = {};
+    std::vector<ListingLine> mListing;
+
+private:
+    void Build(const uint8_t* rom, size_t size);
+    void FindSelfModifyingWrites();
+    void BuildListing(const uint8_t* rom);
+
+    std::array<int32_t, HEAP_SIZE> mLineByAddress;
+};
@@ -0,0 +1,717 @@
+#include "StreamServer.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <imgui.h>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Stream Codec =======================================================================================================
+static void AppendU16(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+static void AppendU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    AppendU16(out, value & 0xFFFF);
+    AppendU16(out, value >> 16);
+}
+
+static void AppendU64(std::vector<uint8_t>& out, uint64_t value)
+{
+    AppendU32(out, static_cast<uint32_t>(value));
+    AppendU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void StreamCodec::PackFrame(const uint32_t* pixels, StreamFrame& frame)
+{
+    for (size_t byte = 0; byte < STREAM_FRAME_BYTES; ++byte)
+    {
+        const uint32_t* source = pixels + byte * 8;
+        uint8_t packed = 0;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            packed = static_cast<uint8_t>((packed << 1) | (source[bit] != 0));
+        }
+        frame[byte] = packed;
+    }
+}
+
+void StreamCodec::AppendHeader(std::vector<uint8_t>& out, StreamMessage type, uint32_t length)
+{
+    out.push_back(static_cast<uint8_t>(type));
+    AppendU32(out, length);
+}
+
+void StreamCodec::AppendKeyframe(std::vector<uint8_t>& out, const StreamFrame& frame, uint32_t tick, uint64_t timestamp)
+{
+    AppendHeader(out, StreamMessage::Keyframe, static_cast<uint32_t>(12 + STREAM_FRAME_BYTES));
+    AppendU32(out, tick);
+    AppendU64(out, timestamp);
+    out.insert(out.end(), frame.begin(), frame.end());
+}
+
+bool StreamCodec::AppendDelta(std::vector<uint8_t>& out, const StreamFrame& previous, const StreamFrame& frame, uint32_t tick, uint64_t timestamp)
+{
+    std::array<uint8_t, STREAM_MASK_BYTES> mask = {};
+    std::array<uint8_t, STREAM_FRAME_BYTES> changes;
+    size_t changed = 0;
+    for (size_t row = 0; row < OUTPUT_HEIGHT; ++row)
+    {
+        const size_t offset = row * STREAM_ROW_BYTES;
+        if (memcmp(&previous[offset], &frame[offset], STREAM_ROW_BYTES) == 0) { continue; }
+
+        mask[row / 8] |= static_cast<uint8_t>(0x80 >> (row % 8));
+        for (size_t i = 0; i < STREAM_ROW_BYTES; ++i)
+        {
+            changes[changed++] = previous[offset + i] ^ frame[offset + i];
+        }
+    }
+    if (changed == 0) { return false; }
+
+    const size_t start = out.size();
+    AppendHeader(out, StreamMessage::Delta, 0);
+    AppendU32(out, tick);
+    AppendU64(out, timestamp);
+    out.insert(out.end(), mask.begin(), mask.end());
+    EncodeRle(changes.data(), changed, out);
+
+    // Patch the length now the RLE size is known.
+    const uint32_t length = static_cast<uint32_t>(out.size() - start - STREAM_HEADER_SIZE);
+    for (int i = 0; i < 4; ++i)
+    {
+        out[start + 1 + i] = static_cast<uint8_t>(length >> (i * 8));
+    }
+    return true;
+}
+
+bool StreamCodec::ApplyDelta(const uint8_t* data, size_t size, StreamFrame& frame)
+{
+    if (size < STREAM_MASK_BYTES) { return false; }
+
+    size_t rows = 0;
+    for (size_t i = 0; i < STREAM_MASK_BYTES; ++i)
+    {
+        rows += std::popcount(data[i]);
+    }
+
+    std::array<uint8_t, STREAM_FRAME_BYTES> changes;
+    if (!DecodeRle(data + STREAM_MASK_BYTES, size - STREAM_MASK_BYTES, changes.data(), rows * STREAM_ROW_BYTES)) { return false; }
+
+    const uint8_t* change = changes.data();
+    for (size_t row = 0; row < OUTPUT_HEIGHT; ++row)
+    {
+        if ((data[row / 8] & (0x80 >> (row % 8))) == 0) { continue; }
+        for (size_t i = 0; i < STREAM_ROW_BYTES; ++i)
+        {
+            frame[row * STREAM_ROW_BYTES + i] ^= *change++;
+        }
+    }
+    return true;
+}
+
+void StreamCodec::EncodeRle(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+    size_t literalStart = 0, i = 0;
+    auto flushLiterals = [&]()
+    {
+        while (literalStart < i)
+        {
+            const size_t count = std::min<size_t>(128, i - literalStart);
+            out.push_back(static_cast<uint8_t>(count - 1));
+            out.insert(out.end(), data + literalStart, data + literalStart + count);
+            literalStart += count;
+        }
+    };
+
+    while (i < size)
+    {
+        size_t run = 1;
+        while (i + run < size && run < 130 && data[i + run] == data[i]) { ++run; }
+
+        // Runs of 2 cost as much as literals & would split a literal span.
+        if (run < 3)
+        {
+            ++i;
+            continue;
+        }
+
+        flushLiterals();
+        out.push_back(static_cast<uint8_t>(run + 125));
+        out.push_back(data[i]);
+        i += run;
+        literalStart = i;
+    }
+    flushLiterals();
+}
+
+bool StreamCodec::DecodeRle(const uint8_t* data, size_t size, uint8_t* out, size_t outSize)
+{
+    size_t in = 0, written = 0;
+    while (in < size)
+    {
+        const uint8_t control = data[in++];
+        if (control < 128)
+        {
+            const size_t count = control + 1;
+            if (in + count > size || written + count > outSize) { return false; }
+            memcpy(out + written, data + in, count);
+            in += count;
+            written += count;
+        }
+        else
+        {
+            const size_t count = control - 125;
+            if (in >= size || written + count > outSize) { return false; }
+            memset(out + written, data[in++], count);
+            written += count;
+        }
+    }
+    return written == outSize;
+}
+
+uint64_t StreamCodec::GetTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Stream Server ======================================================================================================
+StreamServer::~StreamServer()
+{
+    Stop();
+}
+
+void StreamServer::SubmitFrame(const std::array<uint32_t, OUTPUT_WIDTH * OUTPUT_HEIGHT>& frame)
+{
+    if (!IsRunning())
+    {
+        return;
+    }
+
+    const uint32_t tick = mTick++;
+    StreamFrame packed;
+    StreamCodec::PackFrame(frame.data(), packed);
+    if (mHasSubmittedFrame && packed == mSubmittedFrame)
+    {
+        return;
+    }
+    mSubmittedFrame = packed;
+    mHasSubmittedFrame = true;
+
+    {
+        std::lock_guard lock(mMutex);
+        mLatestFrame = packed;
+        mLatestTick = tick;
+        mLatestTimestamp = StreamCodec::GetTimestamp();
+        mLatestSequence++;
+    }
+#ifdef __linux__
+    eventfd_write(mWakeEvent, 1);
+#endif
+}
+
+void StreamServer::ApplyInput(std::array<bool, 16>& keypad)
+{
+    if (!IsRunning())
+    {
+        return;
+    }
+
+    std::lock_guard lock(mMutex);
+    for (const auto& [key, pressed] : mKeyEvents)
+    {
+        keypad[key] = pressed;
+    }
+    mKeyEvents.clear();
+}
+
+StreamServer::Statistics StreamServer::GetStatistics()
+{
+    std::lock_guard lock(mMutex);
+    return mStatistics;
+}
+
+#ifdef __linux__
+bool StreamServer::Start(const std::string& address)
+{
+    Stop();
+
+    auto fail = [this](const char* what)
+    {
+        std::cerr << "Stream server: " << what << " failed: " << strerror(errno) << std::endl;
+        if (mListenSocket >= 0) { close(mListenSocket); }
+        if (mEpoll >= 0) { close(mEpoll); }
+        if (mWakeEvent >= 0) { close(mWakeEvent); }
+        mListenSocket = mEpoll = mWakeEvent = -1;
+        return false;
+    };
+
+    mUnixPath.clear();
+    if (address.starts_with("unix:"))
+    {
+        sockaddr_un local = {};
+        local.sun_family = AF_UNIX;
+        const std::string path = address.substr(5);
+        if (path.empty() || path.size() >= sizeof(local.sun_path))
+        {
+            std::cerr << "Stream server: invalid socket path " << path << std::endl;
+            return false;
+        }
+        memcpy(local.sun_path, path.c_str(), path.size());
+
+        // Only a stale socket from an earlier run is replaced, never a file the path happens to name.
+        struct stat existing = {};
+        if (lstat(path.c_str(), &existing) == 0)
+        {
+            if (!S_ISSOCK(existing.st_mode))
+            {
+                std::cerr << "Stream server: " << path << " exists and is not a socket" << std::endl;
+                return false;
+            }
+            unlink(path.c_str());
+        }
+
+        mListenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (mListenSocket < 0) { return fail("socket"); }
+        if (bind(mListenSocket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) { return fail("bind"); }
+        mUnixPath = path;
+    }
+    else
+    {
+        const size_t colon = address.rfind(':');
+        const std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+        const std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+
+        sockaddr_in inet = {};
+        inet.sin_family = AF_INET;
+        char* end = nullptr;
+        const unsigned long portNumber = strtoul(port.c_str(), &end, 10);
+        if (port.empty() || *end != '\0' || portNumber > 65535 || inet_pton(AF_INET, host.c_str(), &inet.sin_addr) != 1)
+        {
+            std::cerr << "Stream server: invalid address " << address << std::endl;
+            return false;
+        }
+        inet.sin_port = htons(static_cast<uint16_t>(portNumber));
+
+        mListenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (mListenSocket < 0) { return fail("socket"); }
+        const int reuse = 1;
+        setsockopt(mListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(mListenSocket, reinterpret_cast<sockaddr*>(&inet), sizeof(inet)) < 0) { return fail("bind"); }
+    }
+
+    if (listen(mListenSocket, SOMAXCONN) < 0) { return fail("listen"); }
+
+    mEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpoll < 0) { return fail("epoll_create1"); }
+    mWakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeEvent < 0) { return fail("eventfd"); }
+
+    for (int socket : { mListenSocket, mWakeEvent })
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, socket, &event) < 0) { return fail("epoll_ctl"); }
+    }
+
+    mClients.clear();
+    mSharedDelta.clear();
+    mSharedSequence = 0;
+    mBroadcastSequence = 0;
+    mHasSubmittedFrame = false;
+    mTick = 0;
+    {
+        std::lock_guard lock(mMutex);
+        mLatestSequence = 0;
+        mKeyEvents.clear();
+        mStatistics = {};
+    }
+
+    snprintf(mAddressInput, sizeof(mAddressInput), "%s", address.c_str());
+    mStopping = false;
+    mThread = std::thread(&StreamServer::EventLoop, this);
+    return true;
+}
+
+void StreamServer::Stop()
+{
+    if (!IsRunning())
+    {
+        return;
+    }
+
+    mStopping = true;
+    eventfd_write(mWakeEvent, 1);
+    mThread.join();
+
+    while (!mClients.empty())
+    {
+        CloseClient(mClients.begin()->first);
+    }
+    close(mWakeEvent);
+    close(mEpoll);
+    close(mListenSocket);
+    mWakeEvent = mEpoll = mListenSocket = -1;
+
+    if (!mUnixPath.empty())
+    {
+        unlink(mUnixPath.c_str());
+        mUnixPath.clear();
+    }
+}
+
+void StreamServer::EventLoop()
+{
+    std::array<epoll_event, 64> events;
+    std::vector<int> closing;
+    while (!mStopping)
+    {
+        const int count = epoll_wait(mEpoll, events.data(), static_cast<int>(events.size()), -1);
+        if (count < 0)
+        {
+            if (errno == EINTR) { continue; }
+            std::cerr << "Stream server: epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            const int socket = events[i].data.fd;
+            const uint32_t flags = events[i].events;
+            if (socket == mWakeEvent)
+            {
+                eventfd_t value;
+                eventfd_read(mWakeEvent, &value);
+                if (mStopping) { break; }
+
+                UpdateBroadcast();
+                for (auto& [clientSocket, client] : mClients)
+                {
+                    if (!SendLatestFrame(*client)) { closing.push_back(clientSocket); }
+                }
+            }
+            else if (socket == mListenSocket)
+            {
+                AcceptClients();
+            }
+            else if (auto it = mClients.find(socket); it != mClients.end())
+            {
+                Client& client = *it->second;
+                bool open = true;
+                if (flags & EPOLLIN) { open = ReadClient(client); }
+                if (flags & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) { open = false; }
+
+                // Once the backlog drains, catch up with a single delta from the last frame this client was sent.
+                if (open && (flags & EPOLLOUT)) { open = FlushClient(client) && (!client.mWritable || SendLatestFrame(client)); }
+                if (!open) { closing.push_back(socket); }
+            }
+        }
+
+        for (int socket : closing)
+        {
+            CloseClient(socket);
+        }
+        closing.clear();
+    }
+}
+
+void StreamServer::UpdateBroadcast()
+{
+    StreamFrame frame;
+    uint32_t tick;
+    uint64_t timestamp, sequence;
+    {
+        std::lock_guard lock(mMutex);
+        if (mLatestSequence == mBroadcastSequence) { return; }
+        frame = mLatestFrame;
+        tick = mLatestTick;
+        timestamp = mLatestTimestamp;
+        sequence = mLatestSequence;
+    }
+
+    // Clients that are keeping up all share one encoded delta.
+    mSharedDelta.clear();
+    if (mBroadcastSequence != 0)
+    {
+        StreamCodec::AppendDelta(mSharedDelta, mBroadcastFrame, frame, tick, timestamp);
+    }
+    mSharedSequence = mBroadcastSequence;
+
+    mBroadcastFrame = frame;
+    mBroadcastTick = tick;
+    mBroadcastTimestamp = timestamp;
+    mBroadcastSequence = sequence;
+}
+
+void StreamServer::AcceptClients()
+{
+    while (true)
+    {
+        const int socket = accept4(mListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                std::cerr << "Stream server: accept failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        // Frames are small & latency sensitive, don't let Nagle hold them back.
+        if (mUnixPath.empty())
+        {
+            const int noDelay = 1;
+            setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = socket;
+        if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, socket, &event) < 0)
+        {
+            close(socket);
+            continue;
+        }
+
+        auto client = std::make_unique<Client>();
+        client->mSocket = socket;
+        StreamCodec::AppendHeader(client->mOutput, StreamMessage::Hello, 5);
+        client->mOutput.push_back(STREAM_VERSION);
+        AppendU16(client->mOutput, OUTPUT_WIDTH);
+        AppendU16(client->mOutput, OUTPUT_HEIGHT);
+
+        Client& added = *client;
+        mClients[socket] = std::move(client);
+        {
+            std::lock_guard lock(mMutex);
+            mStatistics.mClients = mClients.size();
+        }
+
+        if (!SendLatestFrame(added) || !FlushClient(added))
+        {
+            CloseClient(socket);
+        }
+    }
+}
+
+bool StreamServer::SendLatestFrame(Client& client)
+{
+    // Clients waiting on the kernel skip frames until EPOLLOUT, rather than queueing them.
+    if (mBroadcastSequence == 0 || client.mSequence == mBroadcastSequence || !client.mWritable)
+    {
+        return true;
+    }
+
+    const size_t start = client.mOutput.size();
+    const bool keyframe = client.mSequence == 0;
+    if (keyframe)
+    {
+        StreamCodec::AppendKeyframe(client.mOutput, mBroadcastFrame, mBroadcastTick, mBroadcastTimestamp);
+    }
+    else if (client.mSequence == mSharedSequence)
+    {
+        client.mOutput.insert(client.mOutput.end(), mSharedDelta.begin(), mSharedDelta.end());
+    }
+    else
+    {
+        StreamCodec::AppendDelta(client.mOutput, client.mFrame, mBroadcastFrame, mBroadcastTick, mBroadcastTimestamp);
+    }
+    client.mFrame = mBroadcastFrame;
+    client.mSequence = mBroadcastSequence;
+
+    // The frame may have changed back to what this client already has.
+    const size_t bytes = client.mOutput.size() - start;
+    if (bytes == 0)
+    {
+        return true;
+    }
+    client.mPendingTimestamp = mBroadcastTimestamp;
+
+    {
+        std::lock_guard lock(mMutex);
+        mStatistics.mFramesSent++;
+        mStatistics.mKeyframesSent += keyframe;
+        mStatistics.mBytesSent += bytes;
+        mStatistics.mBytesPerFrame += (static_cast<float>(bytes) - mStatistics.mBytesPerFrame) * 0.05f;
+    }
+    return FlushClient(client);
+}
+
+bool StreamServer::ReadClient(Client& client)
+{
+    std::array<uint8_t, 1024> buffer;
+    while (true)
+    {
+        const ssize_t received = recv(client.mSocket, buffer.data(), buffer.size(), 0);
+        if (received > 0)
+        {
+            client.mInput.insert(client.mInput.end(), buffer.begin(), buffer.begin() + received);
+            continue;
+        }
+        if (received == 0) { return false; }
+        if (errno == EINTR) { continue; }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+        return false;
+    }
+
+    size_t offset = 0;
+    bool replied = false;
+    while (client.mInput.size() - offset >= STREAM_HEADER_SIZE)
+    {
+        const uint8_t* message = &client.mInput[offset];
+        uint32_t length = 0;
+        memcpy(&length, message + 1, sizeof(length));
+        if (length > MAX_INPUT_MESSAGE) { return false; }
+        if (client.mInput.size() - offset < STREAM_HEADER_SIZE + length) { break; }
+
+        const uint8_t* payload = message + STREAM_HEADER_SIZE;
+        switch (static_cast<StreamMessage>(message[0]))
+        {
+        case StreamMessage::Key:
+            if (length >= 2)
+            {
+                const uint8_t key = payload[0] & 0xF;
+                const bool pressed = payload[1] != 0;
+                client.mHeldKeys = static_cast<uint16_t>(pressed ? client.mHeldKeys | (1 << key) : client.mHeldKeys & ~(1 << key));
+                std::lock_guard lock(mMutex);
+                mKeyEvents.emplace_back(key, pressed);
+            }
+            break;
+        case StreamMessage::Ping:
+            if (length >= 8)
+            {
+                StreamCodec::AppendHeader(client.mOutput, StreamMessage::Pong, 8);
+                client.mOutput.insert(client.mOutput.end(), payload, payload + 8);
+                replied = true;
+            }
+            break;
+        default:
+            break;
+        }
+        offset += STREAM_HEADER_SIZE + length;
+    }
+    client.mInput.erase(client.mInput.begin(), client.mInput.begin() + offset);
+
+    // A client that sends requests without reading the replies is dropped rather than buffered forever.
+    if (client.mOutput.size() - client.mOutputOffset > MAX_PENDING_BYTES) { return false; }
+    return !replied || FlushClient(client);
+}
+
+bool StreamServer::FlushClient(Client& client)
+{
+    while (client.mOutputOffset < client.mOutput.size())
+    {
+        const ssize_t sent = send(client.mSocket, client.mOutput.data() + client.mOutputOffset, client.mOutput.size() - client.mOutputOffset, MSG_NOSIGNAL);
+        if (sent >= 0)
+        {
+            client.mOutputOffset += sent;
+            continue;
+        }
+        if (errno == EINTR) { continue; }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) { return false; }
+
+        if (client.mWritable)
+        {
+            client.mWritable = false;
+            epoll_event event = {};
+            event.events = EPOLLIN | EPOLLRDHUP | EPOLLOUT;
+            event.data.fd = client.mSocket;
+            epoll_ctl(mEpoll, EPOLL_CTL_MOD, client.mSocket, &event);
+        }
+        return true;
+    }
+
+    client.mOutput.clear();
+    client.mOutputOffset = 0;
+    if (!client.mWritable)
+    {
+        client.mWritable = true;
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = client.mSocket;
+        epoll_ctl(mEpoll, EPOLL_CTL_MOD, client.mSocket, &event);
+    }
+
+    if (client.mPendingTimestamp != 0)
+    {
+        const float latency = static_cast<float>(StreamCodec::GetTimestamp() - client.mPendingTimestamp);
+        client.mPendingTimestamp = 0;
+
+        std::lock_guard lock(mMutex);
+        mStatistics.mLatency += (latency - mStatistics.mLatency) * 0.05f;
+        mStatistics.mMaxLatency = std::max(mStatistics.mMaxLatency, latency);
+    }
+    return true;
+}
+
+void StreamServer::CloseClient(int socket)
+{
+    auto it = mClients.find(socket);
+    if (it == mClients.end())
+    {
+        return;
+    }
+
+    std::lock_guard lock(mMutex);
+    for (uint8_t key = 0; key < 16; ++key)
+    {
+        if (it->second->mHeldKeys & (1 << key)) { mKeyEvents.emplace_back(key, false); }
+    }
+    epoll_ctl(mEpoll, EPOLL_CTL_DEL, socket, nullptr);
+    close(socket);
+    mClients.erase(it);
+    mStatistics.mClients = mClients.size();
+}
+#else
+bool StreamServer::Start(const std::string&)
+{
+    std::cerr << "Stream server: not supported on this platform, it needs epoll" << std::endl;
+    return false;
+}
+
+void StreamServer::Stop()
+{
+}
+#endif
+
+void StreamServer::DrawImGuiMenu()
+{
+    if (!ImGui::CollapsingHeader("Streaming"))
+    {
+        return;
+    }
+
+    if (IsRunning())
+    {
+        const Statistics statistics = GetStatistics();
+        ImGui::Text("Serving on %s", mAddressInput);
+        ImGui::Text("%zu client(s)", statistics.mClients);
+        ImGui::Text("%llu frames (%llu keyframes), %.1f KB", static_cast<unsigned long long>(statistics.mFramesSent),
+                    static_cast<unsigned long long>(statistics.mKeyframesSent), statistics.mBytesSent / 1024.f);
+        ImGui::Text("%.0f bytes/frame", statistics.mBytesPerFrame);
+        ImGui::Text("Latency: %.0f us avg, %.0f us max", statistics.mLatency, statistics.mMaxLatency);
+        if (ImGui::Button("Stop Server")) { Stop(); }
+    }
+    else
+    {
+        ImGui::InputText("Address##Stream", mAddressInput, sizeof(mAddressInput));
+        if (ImGui::Button("Start Server")) { Start(mAddressInput); }
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Chip8.h"
+
+// Stream Protocol ====================================================================================================
+// Every message is a 1 byte StreamMessage type & a 4 byte payload length, then the payload. Integers are little-endian.
+//
+// Server to client:
+//   Hello      u8 version, u16 width, u16 height
+//   Keyframe   u32 tick, u64 timestamp, packed frame
+//   Delta      u32 tick, u64 timestamp, dirty row bitmask (1 bit per row), RLE of the dirty rows XOR the previous frame
+//   Pong       u64 timestamp echoed from the Ping
+// Client to server:
+//   Key        u8 key, u8 pressed
+//   Ping       u64 timestamp
+//
+// Packed frames are 1 bit per pixel, most significant bit leftmost. Ticks count 60hz frames since streaming started,
+// timestamps are steady clock microseconds so a client on the same machine can measure delivery latency.
+//
+// RLE control byte c: below 128, c + 1 literal bytes follow; otherwise the next byte repeats c - 125 times.
+
+enum class StreamMessage : uint8_t
+{
+    Hello,
+    Keyframe,
+    Delta,
+    Pong,
+    Key = 16,
+    Ping,
+};
+
+constexpr uint8_t STREAM_VERSION = 1;
+constexpr size_t STREAM_HEADER_SIZE = 5;
+constexpr size_t STREAM_ROW_BYTES = OUTPUT_WIDTH / 8;
+constexpr size_t STREAM_MASK_BYTES = OUTPUT_HEIGHT / 8;
+constexpr size_t STREAM_FRAME_BYTES = STREAM_ROW_BYTES * OUTPUT_HEIGHT;
+
+using StreamFrame = std::array<uint8_t, STREAM_FRAME_BYTES>;
+
+// Frame encoding shared by the server & clients.
+class StreamCodec
+{
+public:
+    static void PackFrame(const uint32_t* pixels, StreamFrame& frame);
+
+    // Appends a whole message, header included. AppendDelta appends nothing & returns false if the frames match.
+    static void AppendHeader(std::vector<uint8_t>& out, StreamMessage type, uint32_t length);
+    static void AppendKeyframe(std::vector<uint8_t>& out, const StreamFrame& frame, uint32_t tick, uint64_t timestamp);
+    static bool AppendDelta(std::vector<uint8_t>& out, const StreamFrame& previous, const StreamFrame& frame, uint32_t tick, uint64_t timestamp);
+
+    // Applies a Delta payload after its tick & timestamp, returns false if it's malformed.
+    static bool ApplyDelta(const uint8_t* data, size_t size, StreamFrame& frame);
+
+    static void EncodeRle(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+    static bool DecodeRle(const uint8_t* data, size_t size, uint8_t* out, size_t outSize);
+
+    static uint64_t GetTimestamp();
+};
+
+// Serves the framebuffer to any number of clients over TCP or a Unix domain socket, & feeds their keypad input back.
+// The emulator thread only packs & compares the frame, an epoll event loop on its own thread does all socket work.
+// Clients that fall behind have frames skipped & receive one delta from the last frame they were sent.
+class StreamServer
+{
+public:
+    ~StreamServer();
+
+    // "unix:/path/to/socket", "host:port" or "port", TCP binds to 127.0.0.1 when no host is given.
+    bool Start(const std::string& address);
+    void Stop();
+    bool IsRunning() const { return mListenSocket >= 0; }
+
+    // Emulator thread, once per 60hz frame.
+    void SubmitFrame(const std::array<uint32_t, OUTPUT_WIDTH * OUTPUT_HEIGHT>& frame);
+    void ApplyInput(std::array<bool, 16>& keypad);
+
+    struct Statistics
+    {
+        size_t mClients = 0;
+        uint64_t mFramesSent = 0;       // Keyframe & Delta messages, summed over clients.
+        uint64_t mKeyframesSent = 0;
+        uint64_t mBytesSent = 0;        // Frame message bytes.
+        float mBytesPerFrame = 0.f;     // Running average.
+        float mLatency = 0.f;           // Microseconds from SubmitFrame to the kernel taking the last byte, running average.
+        float mMaxLatency = 0.f;
+    };
+    Statistics GetStatistics();
+
+    void DrawImGuiMenu();
+
+private:
+    // Caps unsent Ping replies, a client past this is dropped. Frames never queue, a client is skipped for frames
+    // whenever its last send hit EAGAIN.
+    static constexpr size_t MAX_PENDING_BYTES = 64 * 1024;
+    static constexpr size_t MAX_INPUT_MESSAGE = 64;
+
+    struct Client
+    {
+        int mSocket = -1;
+        std::vector<uint8_t> mOutput;
+        size_t mOutputOffset = 0;
+        std::vector<uint8_t> mInput;
+        StreamFrame mFrame = {};        // Last frame queued to this client.
+        uint64_t mSequence = 0;         // Sequence of mFrame, 0 before the first keyframe.
+        uint64_t mPendingTimestamp = 0; // Submit time of the newest frame in mOutput, 0 if none.
+        bool mWritable = true;          // False while waiting on EPOLLOUT.
+        uint16_t mHeldKeys = 0;         // Released on disconnect so a dropped client can't leave a key stuck down.
+    };
+
+    void EventLoop();
+    void UpdateBroadcast();
+    void AcceptClients();
+    bool SendLatestFrame(Client& client);
+    bool ReadClient(Client& client);
+    bool FlushClient(Client& client);
+    void CloseClient(int socket);
+
+    // Socket state, the loop thread owns these once started.
+    int mListenSocket = -1;
+    int mEpoll = -1;
+    int mWakeEvent = -1;
+    std::string mUnixPath; // Unlinked on Stop.
+    std::thread mThread;
+    std::atomic<bool> mStopping = false;
+    std::unordered_map<int, std::unique_ptr<Client>> mClients;
+
+    // Delta from the previous broadcast frame, shared by every client that was sent it.
+    std::vector<uint8_t> mSharedDelta;
+    uint64_t mSharedSequence = 0;
+    StreamFrame mBroadcastFrame = {};
+    uint32_t mBroadcastTick = 0;
+    uint64_t mBroadcastTimestamp = 0;
+    uint64_t mBroadcastSequence = 0;
+
+    // Emulator thread state.
+    StreamFrame mSubmittedFrame = {};
+    bool mHasSubmittedFrame = false;
+    uint32_t mTick = 0;
+
+    // Shared, guarded by mMutex.
+    std::mutex mMutex;
+    StreamFrame mLatestFrame = {};
+    uint32_t mLatestTick = 0;
+    uint64_t mLatestTimestamp = 0;
+    uint64_t mLatestSequence = 0;
+    std::vector<std::pair<uint8_t, bool>> mKeyEvents;
+    Statistics mStatistics;
+
+    char mAddressInput[256] = "5800";
+};
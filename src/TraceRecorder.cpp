@@ -0,0 +1,360 @@
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <imgui.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+TraceRecorder::~TraceRecorder()
+{
+    Stop();
+}
+
+bool TraceRecorder::Start(const std::string& path)
+{
+    Stop();
+
+    mFile = fopen(path.c_str(), "wb");
+    if (mFile == nullptr)
+    {
+        std::cerr << "Unable to open trace file " << path << std::endl;
+        return false;
+    }
+
+    TraceFileHeader header = {};
+    memcpy(header.mMagic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.mVersion = TRACE_VERSION;
+    header.mChunkSize = MAX_PACKED_CHUNK;
+    fwrite(&header, sizeof(header), 1, mFile);
+
+    for (std::vector<TraceCapture>& chunk : mChunks)
+    {
+        chunk.resize(CHUNK_CAPTURES);
+    }
+    mActiveChunk = 0;
+    mCursor = mChunks[0].data();
+    mChunkLimit = mCursor + CHUNK_CAPTURES - 3;
+    mRecordCount = 0;
+    mPendingCaptures = nullptr;
+    mStopping = false;
+    mPacked.resize(MAX_PACKED_CHUNK);
+    mPackedRegisters = {};
+
+    mWriter = std::thread(&TraceRecorder::WriterLoop, this);
+    return true;
+}
+
+void TraceRecorder::Stop()
+{
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    if (mCursor != mChunks[mActiveChunk].data())
+    {
+        SubmitChunk();
+    }
+
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    mWriter.join();
+
+    // Patch the final record count into the header.
+    fseek(mFile, offsetof(TraceFileHeader, mRecordCount), SEEK_SET);
+    fwrite(&mRecordCount, sizeof(mRecordCount), 1, mFile);
+    fclose(mFile);
+    mFile = nullptr;
+}
+
+void TraceRecorder::SubmitChunk()
+{
+    // Wait for the writer to finish the previous chunk before handing over this one.
+    std::unique_lock lock(mMutex);
+    mCondition.wait(lock, [this]() { return mPendingCaptures == nullptr; });
+    mPendingCaptures = mChunks[mActiveChunk].data();
+    mPendingCount = mCursor - mPendingCaptures;
+    lock.unlock();
+    mCondition.notify_all();
+
+    mActiveChunk ^= 1;
+    mCursor = mChunks[mActiveChunk].data();
+    mChunkLimit = mCursor + CHUNK_CAPTURES - 3;
+}
+
+void TraceRecorder::WriterLoop()
+{
+    std::unique_lock lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this]() { return mPendingCaptures != nullptr || mStopping; });
+
+        if (mPendingCaptures != nullptr)
+        {
+            const TraceCapture* captures = mPendingCaptures;
+            const size_t count = mPendingCount;
+
+            lock.unlock();
+            WriteChunk(captures, count);
+            lock.lock();
+
+            mPendingCaptures = nullptr;
+            mCondition.notify_all();
+            continue;
+        }
+
+        if (mStopping) { break; }
+    }
+}
+
+void TraceRecorder::WriteChunk(const TraceCapture* captures, size_t count)
+{
+    TraceChunkHeader header = {};
+    uint8_t* out = mPacked.data();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TraceCapture& capture = captures[i];
+        if (capture.mType != TraceCapture::STEP)
+        {
+            if (capture.mType == TraceCapture::SYNC) { mPackedRegisters = capture.mRegisters; }
+            continue;
+        }
+
+        const uint16_t changed = static_cast<uint16_t>(ChangedBytes(&mPackedRegisters[0], &capture.mRegisters[0]) |
+                                                       (ChangedBytes(&mPackedRegisters[8], &capture.mRegisters[8]) << 8));
+        mPackedRegisters = capture.mRegisters;
+
+        memcpy(out, &capture.mFrame, 4);
+        memcpy(out + 4, &capture.mProgramCounter, 2);
+        memcpy(out + 6, &capture.mInstruction, 2);
+        memcpy(out + 8, &capture.mIndexRegister, 2);
+        memcpy(out + 10, &changed, 2);
+        out[12] = capture.mWriteLength;
+        out += TRACE_RECORD_FIXED_SIZE;
+
+        for (uint16_t mask = changed; mask != 0; mask &= mask - 1)
+        {
+            *out++ = capture.mRegisters[std::countr_zero(mask)];
+        }
+
+        // The write data capture always directly follows its step.
+        if (capture.mWriteLength > 0 && i + 1 < count)
+        {
+            memcpy(out, &capture.mWriteAddress, 2);
+            memcpy(out + 2, captures[i + 1].mRegisters.data(), capture.mWriteLength);
+            out += 2 + capture.mWriteLength;
+            ++i;
+        }
+        header.mRecordCount++;
+    }
+
+    if (header.mRecordCount == 0) { return; }
+    header.mSize = static_cast<uint32_t>(out - mPacked.data());
+    fwrite(&header, sizeof(header), 1, mFile);
+    fwrite(mPacked.data(), 1, header.mSize, mFile);
+}
+
+void TraceRecorder::DrawImGuiMenu()
+{
+    if (!ImGui::CollapsingHeader("Trace"))
+    {
+        return;
+    }
+
+    if (IsRecording())
+    {
+        ImGui::Text("Recording to %s", mPathInput);
+        ImGui::Text("%llu instructions", static_cast<unsigned long long>(GetRecordCount()));
+        if (ImGui::Button("Stop Trace")) { Stop(); }
+    }
+    else
+    {
+        ImGui::InputText("Path##Trace", mPathInput, sizeof(mPathInput));
+        if (ImGui::Button("Start Trace")) { Start(mPathInput); }
+    }
+}
+
+// Trace File =========================================================================================================
+TraceFile::~TraceFile()
+{
+    Close();
+}
+
+bool TraceFile::Open(const std::string& path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    mFileHandle = file;
+    mMappingHandle = mapping;
+    mMapping = view;
+    mMappingSize = static_cast<size_t>(size.QuadPart);
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) { return false; }
+
+    struct stat status;
+    fstat(file, &status);
+    mMappingSize = static_cast<size_t>(status.st_size);
+
+    void* view = mMappingSize > 0 ? mmap(nullptr, mMappingSize, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file);
+    mMapping = view != MAP_FAILED ? view : nullptr;
+#endif
+
+    if (mMapping == nullptr || mMappingSize < sizeof(TraceFileHeader))
+    {
+        Close();
+        return false;
+    }
+
+    const auto* header = static_cast<const TraceFileHeader*>(mMapping);
+    if (memcmp(header->mMagic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header->mVersion != TRACE_VERSION)
+    {
+        Close();
+        return false;
+    }
+
+    // Index every complete chunk. A recorder that didn't stop cleanly leaves the header count at 0 & may leave a
+    // partial chunk, so the count comes from the chunks themselves. Each chunk's records are walked once so a corrupt
+    // chunk ends the index rather than letting later reads run off the mapping.
+    const uint8_t* data = static_cast<const uint8_t*>(mMapping);
+    size_t offset = sizeof(TraceFileHeader);
+    while (mMappingSize - offset >= sizeof(TraceChunkHeader))
+    {
+        TraceChunkHeader chunk;
+        memcpy(&chunk, data + offset, sizeof(chunk));
+        if (chunk.mSize > header->mChunkSize || mMappingSize - offset - sizeof(chunk) < chunk.mSize) { break; }
+
+        const uint8_t* begin = data + offset + sizeof(chunk);
+        const uint8_t* end = begin + chunk.mSize;
+        const uint8_t* next = begin;
+        TraceRecord record;
+        for (uint32_t i = 0; i < chunk.mRecordCount && next != nullptr; ++i)
+        {
+            next = DecodeRecord(next, end, record);
+        }
+        if (next != end) { break; }
+
+        mChunks.push_back({ mRecordCount, begin, end });
+        mRecordCount += chunk.mRecordCount;
+        offset += sizeof(chunk) + chunk.mSize;
+    }
+    if (header->mRecordCount != 0)
+    {
+        mRecordCount = std::min(header->mRecordCount, mRecordCount);
+    }
+
+    mCursorIndex = 0;
+    mCursorChunk = 0;
+    mCursorData = mChunks.empty() ? nullptr : mChunks[0].mData;
+    return true;
+}
+
+TraceRecord TraceFile::GetRecord(uint64_t index)
+{
+    // Seek to the start of the containing chunk unless the cursor is already in it & at or before the record.
+    const bool sameChunk = mCursorChunk + 1 >= mChunks.size() || index < mChunks[mCursorChunk + 1].mFirstRecord;
+    if (index < mCursorIndex || !sameChunk)
+    {
+        const auto next = std::upper_bound(mChunks.begin(), mChunks.end(), index,
+                                           [](uint64_t value, const Chunk& chunk) { return value < chunk.mFirstRecord; });
+        mCursorChunk = (next - mChunks.begin()) - 1;
+        mCursorIndex = mChunks[mCursorChunk].mFirstRecord;
+        mCursorData = mChunks[mCursorChunk].mData;
+    }
+
+    TraceRecord record;
+    for (;;)
+    {
+        mCursorData = DecodeRecord(mCursorData, mChunks[mCursorChunk].mEnd, record);
+        if (mCursorData == nullptr)
+        {
+            // Open validated every chunk, so this only happens if the file changed underneath the mapping.
+            mCursorIndex = 0;
+            mCursorChunk = 0;
+            mCursorData = mChunks[0].mData;
+            return {};
+        }
+        if (mCursorIndex++ == index) { break; }
+    }
+
+    // Step into the next chunk so sequential reads keep going from here.
+    if (mCursorChunk + 1 < mChunks.size() && mCursorIndex == mChunks[mCursorChunk + 1].mFirstRecord)
+    {
+        mCursorData = mChunks[++mCursorChunk].mData;
+    }
+    return record;
+}
+
+const uint8_t* TraceFile::DecodeRecord(const uint8_t* data, const uint8_t* end, TraceRecord& record)
+{
+    record = {};
+    if (end - data < static_cast<ptrdiff_t>(TRACE_RECORD_FIXED_SIZE)) { return nullptr; }
+    memcpy(&record.mFrame, data, 4);
+    memcpy(&record.mProgramCounter, data + 4, 2);
+    memcpy(&record.mInstruction, data + 6, 2);
+    memcpy(&record.mIndexRegister, data + 8, 2);
+    memcpy(&record.mChangedRegisters, data + 10, 2);
+    record.mWriteLength = data[12];
+    data += TRACE_RECORD_FIXED_SIZE;
+
+    if (end - data < std::popcount(record.mChangedRegisters)) { return nullptr; }
+    for (uint16_t mask = record.mChangedRegisters; mask != 0; mask &= mask - 1)
+    {
+        record.mRegisters[std::countr_zero(mask)] = *data++;
+    }
+
+    if (record.mWriteLength > 0)
+    {
+        if (record.mWriteLength > record.mWriteData.size() || end - data < 2 + record.mWriteLength) { return nullptr; }
+        memcpy(&record.mWriteAddress, data, 2);
+        memcpy(record.mWriteData.data(), data + 2, record.mWriteLength);
+        data += 2 + record.mWriteLength;
+    }
+    return data;
+}
+
+void TraceFile::Close()
+{
+#ifdef _WIN32
+    if (mMapping != nullptr) { UnmapViewOfFile(mMapping); }
+    if (mMappingHandle != nullptr) { CloseHandle(mMappingHandle); }
+    if (mFileHandle != nullptr) { CloseHandle(mFileHandle); }
+    mFileHandle = nullptr;
+    mMappingHandle = nullptr;
+#else
+    if (mMapping != nullptr) { munmap(mMapping, mMappingSize); }
+#endif
+    mMapping = nullptr;
+    mMappingSize = 0;
+    mChunks.clear();
+    mRecordCount = 0;
+    mCursorIndex = 0;
+    mCursorData = nullptr;
+    mCursorChunk = 0;
+}
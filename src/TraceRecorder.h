@@ -0,0 +1,241 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.h"
+
+// Trace File Format ==================================================================================================
+// A TraceFileHeader followed by chunks, each a TraceChunkHeader & mRecordCount packed records. Everything is in host
+// byte order (little-endian on every supported platform) so the file can be memory mapped & decoded in place.
+//
+// Packed record: u32 frame, u16 PC, u16 instruction, u16 I, u16 changed register mask, u8 write length, one byte per
+// changed register in register order, then a u16 write address & the bytes written if the write length isn't 0.
+// Most instructions change one register & write nothing, so records average ~13 bytes.
+
+constexpr char TRACE_MAGIC[8] = { 'C', '8', 'T', 'R', 'A', 'C', 'E', '\0' };
+constexpr uint32_t TRACE_VERSION = 2;
+constexpr size_t TRACE_RECORD_FIXED_SIZE = 13;
+constexpr size_t TRACE_RECORD_MAX_SIZE = TRACE_RECORD_FIXED_SIZE + 2 + 16 + 16;
+
+struct TraceFileHeader
+{
+    char mMagic[8];
+    uint32_t mVersion;
+    uint32_t mChunkSize;   // Largest chunk payload in bytes.
+    uint64_t mRecordCount; // Patched when recording stops.
+    uint64_t mReserved;
+};
+static_assert(sizeof(TraceFileHeader) == 32);
+
+struct TraceChunkHeader
+{
+    uint32_t mRecordCount;
+    uint32_t mSize; // Packed record bytes that follow.
+};
+static_assert(sizeof(TraceChunkHeader) == 8);
+
+// One executed instruction as decoded by TraceFile, I is taken after execution. mRegisters only holds the changed
+// registers, the rest are 0.
+struct TraceRecord
+{
+    uint32_t mFrame;
+    uint16_t mProgramCounter;   // Address the instruction was fetched from.
+    uint16_t mInstruction;
+    uint16_t mIndexRegister;
+    uint16_t mChangedRegisters; // Bit per V register modified by this instruction.
+    uint16_t mWriteAddress;
+    uint8_t mWriteLength;       // Heap bytes written, 0 if none.
+    std::array<uint8_t, 16> mRegisters;
+    std::array<uint8_t, 16> mWriteData;
+};
+
+// Raw capture of one instruction, the emulator thread only copies state into these & the writer thread packs them.
+struct TraceCapture
+{
+    enum Type : uint8_t
+    {
+        STEP,       // Registers after an instruction.
+        SYNC,       // Registers before a Chip::Run, anything outside the instruction set may have changed them.
+        WRITE_DATA, // mRegisters holds the heap bytes written by the preceding step.
+    };
+
+    uint32_t mFrame;
+    uint16_t mProgramCounter;
+    uint16_t mInstruction;
+    uint16_t mIndexRegister;
+    uint16_t mWriteAddress;
+    uint8_t mWriteLength;
+    Type mType;
+    std::array<uint8_t, 16> mRegisters;
+};
+static_assert(sizeof(TraceCapture) == 32);
+
+// Records every instruction executed by Chip::Run<RUN_TRACE>.
+// Instructions are captured into one chunk while a background thread packs & writes the other, the emulator only
+// waits if the writer falls a whole chunk behind. Diffing registers & packing records happens on the writer thread,
+// the per instruction cost is a few stores.
+class TraceRecorder
+{
+public:
+    ~TraceRecorder();
+
+    bool Start(const std::string& path);
+    void Stop();
+    bool IsRecording() const { return mFile != nullptr; }
+    uint64_t GetRecordCount() const { return mRecordCount; }
+
+    void SetFrame(uint32_t frame) { mFrame = frame; }
+
+    // Called by Chip::Run before its loop & around each instruction, inline as they run for every traced instruction.
+    void BeginRun(const Chip& chip)
+    {
+        TraceCapture& capture = *mCursor++;
+        capture.mType = TraceCapture::SYNC;
+        capture.mRegisters = chip.mVariableRegisters;
+
+        // A paused debugger runs nothing, but still syncs every frame.
+        if (mCursor > mChunkLimit)
+        {
+            SubmitChunk();
+        }
+    }
+
+    void BeforeStep(const Chip& chip)
+    {
+        mProgramCounter = chip.mProgramCounter;
+        mWriteAddress = chip.mIndexRegister;
+        mHeapGeneration = chip.GetHeapGeneration();
+    }
+
+    void AfterStep(const Chip& chip)
+    {
+        TraceCapture& capture = *mCursor++;
+        capture.mFrame = mFrame;
+        capture.mProgramCounter = mProgramCounter;
+        capture.mInstruction = chip.mInstruction;
+        capture.mIndexRegister = chip.mIndexRegister;
+        capture.mWriteAddress = mWriteAddress;
+        capture.mWriteLength = 0;
+        capture.mType = TraceCapture::STEP;
+        capture.mRegisters = chip.mVariableRegisters;
+
+        // Instructions that write the heap bump its generation, so only they pay for decoding the access.
+        if (chip.GetHeapGeneration() != mHeapGeneration)
+        {
+            capture.mWriteLength = std::min<uint8_t>(chip.GetMemoryAccess(chip.mInstruction).mLength, 16);
+            TraceCapture& data = *mCursor++;
+            data.mType = TraceCapture::WRITE_DATA;
+            for (uint8_t i = 0; i < capture.mWriteLength; ++i)
+            {
+                data.mRegisters[i] = chip.mHeap[(mWriteAddress + i) & (HEAP_SIZE - 1)];
+            }
+        }
+
+        mRecordCount++;
+        if (mCursor > mChunkLimit)
+        {
+            SubmitChunk();
+        }
+    }
+
+    void DrawImGuiMenu();
+
+private:
+    static constexpr size_t CHUNK_CAPTURES = 8192;
+    static constexpr size_t MAX_PACKED_CHUNK = CHUNK_CAPTURES * TRACE_RECORD_MAX_SIZE;
+
+    // Bit per differing byte across 8 bytes, without a per-register loop.
+    static uint8_t ChangedBytes(const uint8_t* before, const uint8_t* after)
+    {
+        uint64_t lhs, rhs;
+        memcpy(&lhs, before, sizeof(lhs));
+        memcpy(&rhs, after, sizeof(rhs));
+
+        // Fold each differing byte down to its low bit, then gather the eight low bits into the top byte.
+        uint64_t diff = lhs ^ rhs;
+        diff |= diff >> 4;
+        diff |= diff >> 2;
+        diff |= diff >> 1;
+        diff &= 0x0101010101010101ull;
+        return static_cast<uint8_t>((diff * 0x0102040810204080ull) >> 56);
+    }
+
+    void SubmitChunk();
+    void WriterLoop();
+    void WriteChunk(const TraceCapture* captures, size_t count);
+
+    FILE* mFile = nullptr;
+    uint64_t mRecordCount = 0;
+    uint32_t mFrame = 0;
+
+    // Double buffered chunks, mChunks[mActiveChunk] is owned by the emulator thread.
+    std::array<std::vector<TraceCapture>, 2> mChunks;
+    size_t mActiveChunk = 0;
+    TraceCapture* mCursor = nullptr;     // Next capture in the active chunk.
+    TraceCapture* mChunkLimit = nullptr; // Submitted once past this, leaving room for a sync, a step & its write data.
+
+    std::thread mWriter;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    const TraceCapture* mPendingCaptures = nullptr; // Chunk handed to the writer, null once written.
+    size_t mPendingCount = 0;
+    bool mStopping = false;
+
+    // State captured before the current instruction.
+    uint16_t mProgramCounter = 0;
+    uint16_t mWriteAddress = 0; // I, which is where FX33 & FX55 write.
+    uint32_t mHeapGeneration = 0;
+
+    // Writer thread state.
+    std::vector<uint8_t> mPacked;
+    std::array<uint8_t, 16> mPackedRegisters = {}; // Registers as of the last capture packed.
+
+    char mPathInput[256] = "trace.c8trace";
+};
+
+// Read-only memory mapped view of a trace file. Chunk offsets are indexed on open, records are decoded on demand
+// & a cursor makes sequential reads cheap.
+class TraceFile
+{
+public:
+    ~TraceFile();
+
+    bool Open(const std::string& path);
+    void Close();
+
+    uint64_t GetRecordCount() const { return mRecordCount; }
+    TraceRecord GetRecord(uint64_t index);
+
+private:
+    struct Chunk
+    {
+        uint64_t mFirstRecord;
+        const uint8_t* mData;
+        const uint8_t* mEnd;
+    };
+
+    // Returns the next record, or null if this one runs past end or is malformed.
+    static const uint8_t* DecodeRecord(const uint8_t* data, const uint8_t* end, TraceRecord& record);
+
+    std::vector<Chunk> mChunks;
+    uint64_t mRecordCount = 0;
+
+    // Position of the next record to decode.
+    uint64_t mCursorIndex = 0;
+    const uint8_t* mCursorData = nullptr;
+    size_t mCursorChunk = 0;
+
+    void* mMapping = nullptr;
+    size_t mMappingSize = 0;
+#ifdef _WIN32
+    void* mFileHandle = nullptr;
+    void* mMappingHandle = nullptr;
+#endif
+};
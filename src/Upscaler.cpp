@@ -0,0 +1,486 @@
+#include "Upscaler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UPSCALER_SSE2 1
+#include <emmintrin.h>
+#else
+#define UPSCALER_SSE2 0
+#endif
+
+const char* gScaleFilterNames[] = { "nearest", "scale2x", "scale3x", "xbr" };
+
+constexpr int PADDING = 2; // Widest filter neighbourhood, xBR reads 2 pixels out.
+
+// Per byte rounding average, matching _mm_avg_epu8.
+static uint32_t Average(uint32_t a, uint32_t b)
+{
+    return (a | b) - (((a ^ b) >> 1) & 0x7F7F7F7F);
+}
+
+// Offset of (dy, dx) after rotating it a quarter turn Rotation times, letting one corner rule serve all four corners.
+template <int Rotation>
+static constexpr ptrdiff_t Offset(int dy, int dx, int stride)
+{
+    for (int r = 0; r < Rotation; ++r)
+    {
+        const int y = dy;
+        dy = -dx;
+        dx = y;
+    }
+    return static_cast<ptrdiff_t>(dy) * stride + dx;
+}
+
+struct XbrPlanes
+{
+    const uint32_t* mColour;
+    const float* mLuma;
+    const float* mChromaU;
+    const float* mChromaV;
+    int mStride;
+};
+
+// Neighbourhood names used by the filters, relative to E:
+//          A  B  C
+//          D  E  F  F4
+//          G  H  I  I4
+//             H5 I5
+
+// Nearest ============================================================================================================
+static void ReplicateRow(const uint32_t* source, int width, int factor, uint32_t* output)
+{
+    int x = 0;
+#if UPSCALER_SSE2
+    // The common factors shuffle 4 source pixels into whole output vectors.
+    if (factor == 2)
+    {
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 2), _mm_unpacklo_epi32(pixels, pixels));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 2 + 4), _mm_unpackhi_epi32(pixels, pixels));
+        }
+    }
+    else if (factor == 3)
+    {
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 3), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 3 + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 3 + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+        }
+    }
+    else if (factor >= 4)
+    {
+        // Broadcast each pixel, whole vectors first then the remainder.
+        for (; x < width; ++x)
+        {
+            const __m128i pixel = _mm_set1_epi32(static_cast<int>(source[x]));
+            uint32_t* out = output + static_cast<size_t>(x) * factor;
+            int i = 0;
+            for (; i + 4 <= factor; i += 4) { _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), pixel); }
+            for (; i < factor; ++i) { out[i] = source[x]; }
+        }
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        std::fill_n(output + static_cast<size_t>(x) * factor, factor, source[x]);
+    }
+}
+
+static void ScaleNearest(const uint32_t* source, int width, int height, int factor, uint32_t* output)
+{
+    const size_t outputWidth = static_cast<size_t>(width) * factor;
+    for (int y = 0; y < height; ++y)
+    {
+        uint32_t* row = output + static_cast<size_t>(y) * factor * outputWidth;
+        ReplicateRow(source + static_cast<size_t>(y) * width, width, factor, row);
+        for (int copy = 1; copy < factor; ++copy)
+        {
+            memcpy(row + copy * outputWidth, row, outputWidth * sizeof(uint32_t));
+        }
+    }
+}
+
+// Scalar Kernels =====================================================================================================
+// Reference implementations, used for row tails & on targets without SSE2.
+static void Scale2xPixel(uint32_t B, uint32_t D, uint32_t E, uint32_t F, uint32_t H, uint32_t* top, uint32_t* bottom)
+{
+    top[0]    = D == B && B != F && D != H ? D : E;
+    top[1]    = B == F && B != D && F != H ? F : E;
+    bottom[0] = D == H && D != B && H != F ? D : E;
+    bottom[1] = H == F && D != H && B != F ? F : E;
+}
+
+static void Scale3xPixel(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint32_t out[9])
+{
+    const uint32_t A = above[-1], B = above[0], C = above[1];
+    const uint32_t D = row[-1],   E = row[0],   F = row[1];
+    const uint32_t G = below[-1], H = below[0], I = below[1];
+
+    std::fill_n(out, 9, E);
+    if (B == H || D == F) { return; }
+
+    out[0] = D == B ? D : E;
+    out[1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+    out[2] = B == F ? F : E;
+    out[3] = (D == B && E != G) || (D == H && E != A) ? D : E;
+    out[5] = (B == F && E != I) || (H == F && E != C) ? F : E;
+    out[6] = D == H ? D : E;
+    out[7] = (D == H && E != I) || (H == F && E != G) ? H : E;
+    out[8] = H == F ? F : E;
+}
+
+// One output corner of xBR, written for the bottom right & rotated for the others.
+template <int Rotation>
+static uint32_t XbrCorner(const XbrPlanes& planes, ptrdiff_t centre)
+{
+    auto at = [&](int dy, int dx) { return centre + Offset<Rotation>(dy, dx, planes.mStride); };
+    auto colour = [&](int dy, int dx) { return planes.mColour[at(dy, dx)]; };
+    auto distance = [&](int ay, int ax, int by, int bx)
+    {
+        const ptrdiff_t a = at(ay, ax), b = at(by, bx);
+        return 48.f * std::abs(planes.mLuma[a] - planes.mLuma[b]) + 7.f * std::abs(planes.mChromaU[a] - planes.mChromaU[b]) +
+               6.f * std::abs(planes.mChromaV[a] - planes.mChromaV[b]);
+    };
+
+    const uint32_t E = colour(0, 0), B = colour(-1, 0), C = colour(-1, 1), D = colour(0, -1), F = colour(0, 1);
+    const uint32_t G = colour(1, -1), H = colour(1, 0), I = colour(1, 1), I4 = colour(1, 2), I5 = colour(2, 1);
+    if (E == H || E == F) { return E; }
+
+    // Weighted edge strength across each diagonal, the corner is cut along the weaker one.
+    const float edge = distance(0, 0, -1, 1) + distance(0, 0, 1, -1) + distance(1, 1, 2, 0) + distance(1, 1, 0, 2) + 4.f * distance(1, 0, 0, 1);
+    const float across = distance(1, 0, 0, -1) + distance(1, 0, 2, 1) + distance(0, 1, 1, 2) + distance(0, 1, -1, 0) + 4.f * distance(0, 0, 1, 1);
+    const bool guard = (F != B && H != D) || (E == I && F != I4 && H != I5) || E == G || E == C;
+    if (!(edge < across) || !guard) { return E; }
+
+    const uint32_t nearest = distance(0, 0, 0, 1) <= distance(0, 0, 1, 0) ? F : H;
+    return Average(E, nearest);
+}
+
+#if UPSCALER_SSE2
+// SSE2 Kernels =======================================================================================================
+// 4 source pixels per iteration, lane for lane the same rules as the scalar kernels.
+static __m128i Load(const uint32_t* pixels) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)); }
+static void Store(uint32_t* pixels, __m128i value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), value); }
+static __m128i Equal(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+static __m128i Not(__m128i a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+static __m128i And(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+static __m128i Or(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+static __m128i Select(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+static int Scale2xRow(const uint32_t* above, const uint32_t* row, const uint32_t* below, int width, uint32_t* top, uint32_t* bottom)
+{
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        const __m128i B = Load(above + x), D = Load(row + x - 1), E = Load(row + x), F = Load(row + x + 1), H = Load(below + x);
+        const __m128i eqDB = Equal(D, B), eqBF = Equal(B, F), eqDH = Equal(D, H), eqHF = Equal(H, F);
+
+        const __m128i e0 = Select(And(eqDB, Not(Or(eqBF, eqDH))), D, E);
+        const __m128i e1 = Select(And(eqBF, Not(Or(eqDB, eqHF))), F, E);
+        const __m128i e2 = Select(And(eqDH, Not(Or(eqDB, eqHF))), D, E);
+        const __m128i e3 = Select(And(eqHF, Not(Or(eqDH, eqBF))), F, E);
+
+        Store(top + x * 2, _mm_unpacklo_epi32(e0, e1));
+        Store(top + x * 2 + 4, _mm_unpackhi_epi32(e0, e1));
+        Store(bottom + x * 2, _mm_unpacklo_epi32(e2, e3));
+        Store(bottom + x * 2 + 4, _mm_unpackhi_epi32(e2, e3));
+    }
+    return x;
+}
+
+static int Scale3xRow(const uint32_t* above, const uint32_t* row, const uint32_t* below, int width, uint32_t* out[3])
+{
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        const __m128i A = Load(above + x - 1), B = Load(above + x), C = Load(above + x + 1);
+        const __m128i D = Load(row + x - 1),   E = Load(row + x),   F = Load(row + x + 1);
+        const __m128i G = Load(below + x - 1), H = Load(below + x), I = Load(below + x + 1);
+
+        const __m128i active = Not(Or(Equal(B, H), Equal(D, F)));
+        const __m128i eqDB = And(active, Equal(D, B)), eqBF = And(active, Equal(B, F));
+        const __m128i eqDH = And(active, Equal(D, H)), eqHF = And(active, Equal(H, F));
+        const __m128i neEA = Not(Equal(E, A)), neEC = Not(Equal(E, C)), neEG = Not(Equal(E, G)), neEI = Not(Equal(E, I));
+
+        // Results are computed planar then interleaved 3 wide, SSE2 has no cheap 3-way interleave.
+        alignas(16) uint32_t results[9][4];
+        Store(results[0], Select(eqDB, D, E));
+        Store(results[1], Select(Or(And(eqDB, neEC), And(eqBF, neEA)), B, E));
+        Store(results[2], Select(eqBF, F, E));
+        Store(results[3], Select(Or(And(eqDB, neEG), And(eqDH, neEA)), D, E));
+        Store(results[4], E);
+        Store(results[5], Select(Or(And(eqBF, neEI), And(eqHF, neEC)), F, E));
+        Store(results[6], Select(eqDH, D, E));
+        Store(results[7], Select(Or(And(eqDH, neEI), And(eqHF, neEG)), H, E));
+        Store(results[8], Select(eqHF, F, E));
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                uint32_t* pixel = out[r] + (x + lane) * 3;
+                pixel[0] = results[r * 3][lane];
+                pixel[1] = results[r * 3 + 1][lane];
+                pixel[2] = results[r * 3 + 2][lane];
+            }
+        }
+    }
+    return x;
+}
+
+template <int Rotation>
+static __m128i XbrCornerSSE2(const XbrPlanes& planes, ptrdiff_t centre)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    auto at = [&](int dy, int dx) { return centre + Offset<Rotation>(dy, dx, planes.mStride); };
+    auto colour = [&](int dy, int dx) { return Load(planes.mColour + at(dy, dx)); };
+    auto difference = [&](const float* plane, ptrdiff_t a, ptrdiff_t b)
+    {
+        return _mm_and_ps(absMask, _mm_sub_ps(_mm_loadu_ps(plane + a), _mm_loadu_ps(plane + b)));
+    };
+    auto distance = [&](int ay, int ax, int by, int bx)
+    {
+        const ptrdiff_t a = at(ay, ax), b = at(by, bx);
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(48.f), difference(planes.mLuma, a, b)),
+                                     _mm_mul_ps(_mm_set1_ps(7.f), difference(planes.mChromaU, a, b))),
+                          _mm_mul_ps(_mm_set1_ps(6.f), difference(planes.mChromaV, a, b)));
+    };
+    auto sum = [](__m128 a, __m128 b, __m128 c, __m128 d, __m128 weighted)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d), _mm_mul_ps(_mm_set1_ps(4.f), weighted));
+    };
+
+    const __m128i E = colour(0, 0), B = colour(-1, 0), C = colour(-1, 1), D = colour(0, -1), F = colour(0, 1);
+    const __m128i G = colour(1, -1), H = colour(1, 0), I = colour(1, 1), I4 = colour(1, 2), I5 = colour(2, 1);
+
+    const __m128 edge = sum(distance(0, 0, -1, 1), distance(0, 0, 1, -1), distance(1, 1, 2, 0), distance(1, 1, 0, 2), distance(1, 0, 0, 1));
+    const __m128 across = sum(distance(1, 0, 0, -1), distance(1, 0, 2, 1), distance(0, 1, 1, 2), distance(0, 1, -1, 0), distance(0, 0, 1, 1));
+
+    const __m128i differs = Not(Or(Equal(E, H), Equal(E, F)));
+    const __m128i guard = Or(Or(Not(Or(Equal(F, B), Equal(H, D))), And(Equal(E, I), Not(Or(Equal(F, I4), Equal(H, I5))))),
+                             Or(Equal(E, G), Equal(E, C)));
+    const __m128i apply = And(And(differs, guard), _mm_castps_si128(_mm_cmplt_ps(edge, across)));
+
+    const __m128i nearest = Select(_mm_castps_si128(_mm_cmple_ps(distance(0, 0, 0, 1), distance(0, 0, 1, 0))), F, H);
+    return Select(apply, _mm_avg_epu8(E, nearest), E);
+}
+
+static int XbrRow(const XbrPlanes& planes, ptrdiff_t rowStart, int width, uint32_t* top, uint32_t* bottom)
+{
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        const ptrdiff_t centre = rowStart + x;
+        const __m128i topLeft = XbrCornerSSE2<2>(planes, centre);
+        const __m128i topRight = XbrCornerSSE2<1>(planes, centre);
+        const __m128i bottomLeft = XbrCornerSSE2<3>(planes, centre);
+        const __m128i bottomRight = XbrCornerSSE2<0>(planes, centre);
+
+        Store(top + x * 2, _mm_unpacklo_epi32(topLeft, topRight));
+        Store(top + x * 2 + 4, _mm_unpackhi_epi32(topLeft, topRight));
+        Store(bottom + x * 2, _mm_unpacklo_epi32(bottomLeft, bottomRight));
+        Store(bottom + x * 2 + 4, _mm_unpackhi_epi32(bottomLeft, bottomRight));
+    }
+    return x;
+}
+#endif
+
+// Upscaler ===========================================================================================================
+int Upscaler::GetFilterScale(ScaleFilter filter)
+{
+    switch (filter)
+    {
+    case ScaleFilter::Nearest:  return 1;
+    case ScaleFilter::Scale2x:  return 2;
+    case ScaleFilter::Scale3x:  return 3;
+    case ScaleFilter::XBR2x:    return 2;
+    }
+    return 1;
+}
+
+bool Upscaler::ParseFilter(const std::string& name, ScaleFilter& filter)
+{
+    for (size_t i = 0; i < std::size(gScaleFilterNames); ++i)
+    {
+        if (name == gScaleFilterNames[i])
+        {
+            filter = static_cast<ScaleFilter>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Upscaler::GetFilterName(ScaleFilter filter)
+{
+    return gScaleFilterNames[static_cast<int>(filter)];
+}
+
+const uint32_t* Upscaler::Scale(const uint32_t* source, int width, int height, ScaleFilter filter, int factor)
+{
+    factor = std::max(factor, 1);
+    const size_t count = static_cast<size_t>(width) * height;
+
+    mWasCached = width == mWidth && height == mHeight && filter == mFilter && factor == mFactor &&
+                 memcmp(source, mSource.data(), count * sizeof(uint32_t)) == 0;
+    if (mWasCached)
+    {
+        mCacheHits++;
+        return mOutput.data();
+    }
+    mCacheMisses++;
+
+    mSource.assign(source, source + count);
+    mWidth = width;
+    mHeight = height;
+    mFilter = filter;
+    mFactor = factor;
+
+    const int filterScale = GetFilterScale(filter);
+    mOutputWidth = width * filterScale * factor;
+    mOutputHeight = height * filterScale * factor;
+    mOutput.resize(static_cast<size_t>(mOutputWidth) * mOutputHeight);
+
+    if (filter == ScaleFilter::Nearest)
+    {
+        ScaleNearest(source, width, height, factor, mOutput.data());
+        return mOutput.data();
+    }
+
+    // Filter straight into the output when there's no integer pass after it.
+    uint32_t* filtered = mOutput.data();
+    if (factor > 1)
+    {
+        mFiltered.resize(count * filterScale * filterScale);
+        filtered = mFiltered.data();
+    }
+
+    BuildPadded(source);
+    switch (filter)
+    {
+    case ScaleFilter::Scale2x:  FilterScale2x(filtered); break;
+    case ScaleFilter::Scale3x:  FilterScale3x(filtered); break;
+    case ScaleFilter::XBR2x:    FilterXBR2x(filtered); break;
+    default: break;
+    }
+
+    if (factor > 1)
+    {
+        ScaleNearest(filtered, width * filterScale, height * filterScale, factor, mOutput.data());
+    }
+    return mOutput.data();
+}
+
+void Upscaler::BuildPadded(const uint32_t* source)
+{
+    mPaddedWidth = mWidth + PADDING * 2;
+    mPadded.resize(static_cast<size_t>(mPaddedWidth) * (mHeight + PADDING * 2));
+
+    // Edges are clamped, so border pixels compare equal to their neighbour & filters leave them alone.
+    for (int y = 0; y < mHeight + PADDING * 2; ++y)
+    {
+        const uint32_t* sourceRow = source + static_cast<size_t>(std::clamp(y - PADDING, 0, mHeight - 1)) * mWidth;
+        uint32_t* row = &mPadded[static_cast<size_t>(y) * mPaddedWidth];
+        std::fill_n(row, PADDING, sourceRow[0]);
+        memcpy(row + PADDING, sourceRow, mWidth * sizeof(uint32_t));
+        std::fill_n(row + PADDING + mWidth, PADDING, sourceRow[mWidth - 1]);
+    }
+}
+
+void Upscaler::BuildDistancePlanes()
+{
+    mLuma.resize(mPadded.size());
+    mChromaU.resize(mPadded.size());
+    mChromaV.resize(mPadded.size());
+
+    for (size_t i = 0; i < mPadded.size(); ++i)
+    {
+        const float r = static_cast<float>(mPadded[i] >> 24);
+        const float g = static_cast<float>((mPadded[i] >> 16) & 0xFF);
+        const float b = static_cast<float>((mPadded[i] >> 8) & 0xFF);
+        mLuma[i] = 0.299f * r + 0.587f * g + 0.114f * b;
+        mChromaU[i] = -0.169f * r - 0.331f * g + 0.5f * b;
+        mChromaV[i] = 0.5f * r - 0.419f * g - 0.081f * b;
+    }
+}
+
+void Upscaler::FilterScale2x(uint32_t* output)
+{
+    const size_t outputWidth = static_cast<size_t>(mWidth) * 2;
+    for (int y = 0; y < mHeight; ++y)
+    {
+        const uint32_t* above = &mPadded[static_cast<size_t>(y + PADDING - 1) * mPaddedWidth + PADDING];
+        const uint32_t* row = above + mPaddedWidth;
+        const uint32_t* below = row + mPaddedWidth;
+        uint32_t* top = output + y * 2 * outputWidth;
+        uint32_t* bottom = top + outputWidth;
+
+        int x = 0;
+#if UPSCALER_SSE2
+        x = Scale2xRow(above, row, below, mWidth, top, bottom);
+#endif
+        for (; x < mWidth; ++x)
+        {
+            Scale2xPixel(above[x], row[x - 1], row[x], row[x + 1], below[x], top + x * 2, bottom + x * 2);
+        }
+    }
+}
+
+void Upscaler::FilterScale3x(uint32_t* output)
+{
+    const size_t outputWidth = static_cast<size_t>(mWidth) * 3;
+    for (int y = 0; y < mHeight; ++y)
+    {
+        const uint32_t* above = &mPadded[static_cast<size_t>(y + PADDING - 1) * mPaddedWidth + PADDING];
+        const uint32_t* row = above + mPaddedWidth;
+        const uint32_t* below = row + mPaddedWidth;
+        uint32_t* rows[3] = { output + y * 3 * outputWidth, output + (y * 3 + 1) * outputWidth, output + (y * 3 + 2) * outputWidth };
+
+        int x = 0;
+#if UPSCALER_SSE2
+        x = Scale3xRow(above, row, below, mWidth, rows);
+#endif
+        for (; x < mWidth; ++x)
+        {
+            uint32_t pixels[9];
+            Scale3xPixel(above + x, row + x, below + x, pixels);
+            for (int r = 0; r < 3; ++r)
+            {
+                std::copy_n(pixels + r * 3, 3, rows[r] + x * 3);
+            }
+        }
+    }
+}
+
+void Upscaler::FilterXBR2x(uint32_t* output)
+{
+    BuildDistancePlanes();
+    const XbrPlanes planes = { mPadded.data(), mLuma.data(), mChromaU.data(), mChromaV.data(), mPaddedWidth };
+
+    const size_t outputWidth = static_cast<size_t>(mWidth) * 2;
+    for (int y = 0; y < mHeight; ++y)
+    {
+        const ptrdiff_t rowStart = static_cast<ptrdiff_t>(y + PADDING) * mPaddedWidth + PADDING;
+        uint32_t* top = output + y * 2 * outputWidth;
+        uint32_t* bottom = top + outputWidth;
+
+        int x = 0;
+#if UPSCALER_SSE2
+        x = XbrRow(planes, rowStart, mWidth, top, bottom);
+#endif
+        for (; x < mWidth; ++x)
+        {
+            top[x * 2] = XbrCorner<2>(planes, rowStart + x);
+            top[x * 2 + 1] = XbrCorner<1>(planes, rowStart + x);
+            bottom[x * 2] = XbrCorner<3>(planes, rowStart + x);
+            bottom[x * 2 + 1] = XbrCorner<0>(planes, rowStart + x);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ScaleFilter : uint8_t
+{
+    Nearest,    // Integer pixel replication only.
+    Scale2x,    // AdvMAME2x edge rules.
+    Scale3x,    // AdvMAME3x edge rules.
+    XBR2x,      // xBR level 1 style edge detection with 50% corner blending.
+};
+
+// CPU upscaler for RGBA8888 frames: a pixel-art filter pass followed by integer nearest scaling.
+// The last source frame & settings are cached, so asking for an unchanged frame costs a compare instead of a rescale.
+class Upscaler
+{
+public:
+    static int GetFilterScale(ScaleFilter filter);
+    static bool ParseFilter(const std::string& name, ScaleFilter& filter);
+    static const char* GetFilterName(ScaleFilter filter);
+
+    // Output is width * GetFilterScale(filter) * factor wide, likewise high. Valid until the next call.
+    const uint32_t* Scale(const uint32_t* source, int width, int height, ScaleFilter filter, int factor);
+
+    int GetWidth() const { return mOutputWidth; }
+    int GetHeight() const { return mOutputHeight; }
+    bool WasCached() const { return mWasCached; } // Whether the last Scale call reused the previous output.
+    uint64_t GetCacheHits() const { return mCacheHits; }
+    uint64_t GetCacheMisses() const { return mCacheMisses; }
+
+private:
+    void BuildPadded(const uint32_t* source);
+    void BuildDistancePlanes();
+
+    void FilterScale2x(uint32_t* output);
+    void FilterScale3x(uint32_t* output);
+    void FilterXBR2x(uint32_t* output);
+
+    // Cache key.
+    std::vector<uint32_t> mSource;
+    int mWidth = 0;
+    int mHeight = 0;
+    ScaleFilter mFilter = ScaleFilter::Nearest;
+    int mFactor = 0;
+
+    // Source with a 2 pixel clamped border, so filter kernels never bounds check.
+    std::vector<uint32_t> mPadded;
+    std::vector<float> mLuma, mChromaU, mChromaV; // YUV planes matching mPadded, for xBR colour distances.
+    int mPaddedWidth = 0;
+
+    std::vector<uint32_t> mFiltered;
+    std::vector<uint32_t> mOutput;
+    int mOutputWidth = 0;
+    int mOutputHeight = 0;
+
+    bool mWasCached = false;
+    uint64_t mCacheHits = 0;
+    uint64_t mCacheMisses = 0;
+};
@@ -2,11 +2,38 @@
 #include "Chip8.h"
 #include <SDL3/SDL.h>
 #include "imgui.h"
+#include <cstring>
 #include <iostream>
 
 int main(int argc, char* argv[])
 {
     Application app = Application(1280, 720);
+    FramePacer& pacer = app.GetFramePacer();
+
+    // --pacing uncapped|vsync|sleep|latency
+    // --stream <address> serves the display to CHIP8StreamClient & other stream clients, see StreamServer.h.
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (strcmp(argv[i], "--stream") == 0)
+        {
+            app.GetStreamServer().Start(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "--pacing") != 0)
+        {
+            continue;
+        }
+
+        PacingMode mode;
+        if (FramePacer::ParseMode(argv[++i], mode))
+        {
+            pacer.SetMode(mode);
+        }
+        else
+        {
+            std::cerr << "Unknown pacing mode " << argv[i] << std::endl;
+        }
+    }
 
     uint64_t lastTime = SDL_GetPerformanceCounter();
     const uint64_t frequency = SDL_GetPerformanceFrequency();
@@ -14,6 +41,8 @@ int main(int argc, char* argv[])
     bool running = true;
     while (running)
     {
+        pacer.WaitForFrame();
+
         uint64_t currentTime = SDL_GetPerformanceCounter();
         float deltaTime = (currentTime - lastTime) * 1000.0f / frequency;
         lastTime = currentTime;
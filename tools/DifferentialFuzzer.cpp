@@ -0,0 +1,543 @@
+// Differential fuzzer, runs random & mutated instruction streams on the reference interpreter (Fetch, Decode, Execute)
+// and on every alternate engine in lockstep, comparing registers after each instruction & memory after any instruction
+// that can write it.
+//
+// Standalone:  CHIP8Fuzz [--threads N] [--seconds N] [--runs N] [--seed N] [--reproduce file] [corpus files/dirs...]
+// libFuzzer:   build with CHIP8_LIBFUZZER to get LLVMFuzzerTestOneInput instead of main().
+#include "Chip8.h"
+#include "Debugger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Input layout =======================================================================================================
+// [0..3] rng seed, [4..19] V0-VF, [20..21] I, [22] delay timer, [23] sound timer, [24..25] keypad bits.
+// Everything after the header is the program, loaded at 0x200.
+constexpr size_t HEADER_SIZE = 26;
+constexpr size_t MAX_PROGRAM_SIZE = HEAP_SIZE - 0x200;
+constexpr int MAX_STEPS = 256;
+constexpr int STEPS_PER_TIMER_TICK = 12; // Roughly 700hz instructions against 60hz timers.
+
+struct Engine
+{
+    const char* mName;
+    void (*mStep)(Chip& chip);
+};
+
+// Alternate execution paths, each must match the reference exactly.
+const std::array<Engine, 2> gEngines = {{
+    { "Process", [](Chip& chip) { chip.Process(); } },
+    { "DebugRun", [](Chip& chip) { thread_local Debugger debugger; chip.Run<RUN_DEBUG>(1, &debugger); } },
+}};
+
+struct Mismatch
+{
+    std::string mEngine;
+    uint8_t mQuirkFlags = 0;
+    int mStep = 0;
+    uint16_t mProgramCounter = 0;
+    uint16_t mInstruction = 0;
+    std::string mDescription;
+};
+
+static void ReferenceStep(Chip& chip)
+{
+    chip.Fetch();
+    chip.Execute(chip.Decode());
+}
+
+static uint16_t ReadU16(const uint8_t* data)
+{
+    return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+static void LoadCase(Chip& chip, const uint8_t* data, size_t size)
+{
+    uint8_t header[HEADER_SIZE] = { 0 };
+    memcpy(header, data, std::min(size, HEADER_SIZE));
+
+    chip.SeedRandom(static_cast<uint32_t>((header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3]));
+    memcpy(chip.mVariableRegisters.data(), &header[4], 16);
+    chip.mIndexRegister = ReadU16(&header[20]);
+    chip.mDelayTimer = header[22];
+    chip.mSoundTimer = header[23];
+
+    const uint16_t keypad = ReadU16(&header[24]);
+    for (int i = 0; i < 16; ++i)
+    {
+        chip.mKeypad[i] = (keypad >> i) & 1;
+    }
+
+    if (size > HEADER_SIZE)
+    {
+        memcpy(&chip.mHeap[0x200], data + HEADER_SIZE, std::min(size - HEADER_SIZE, MAX_PROGRAM_SIZE));
+    }
+}
+
+// Copies the state a case starts from without reassigning the whole Chip, whose opcode map & stack would otherwise
+// be reallocated for every engine & quirk combination.
+static void ResetFromImage(Chip& chip, const Chip& image, uint8_t quirks)
+{
+    chip.mProgramCounter = image.mProgramCounter;
+    chip.mIndexRegister = image.mIndexRegister;
+    chip.mInstruction = image.mInstruction;
+    chip.mVariableRegisters = image.mVariableRegisters;
+    chip.mHeap = image.mHeap;
+    chip.mDisplayOutput = image.mDisplayOutput;
+    chip.mDelayTimer = image.mDelayTimer;
+    chip.mSoundTimer = image.mSoundTimer;
+    chip.mKeypad = image.mKeypad;
+    chip.mRomSize = image.mRomSize;
+    while (!chip.mStack.empty()) { chip.mStack.pop(); }
+    chip.ResetGenerations();
+
+    chip.mQuirks.SetFlags(quirks);
+    chip.ApplyQuirks();
+}
+
+// Registers, PC, I, stack & write generations can change on any instruction, so they're compared after every step.
+// Matching generations also mean an engine that skips (or adds) a heap or display write is caught on that step.
+// Page generations only move with the heap generation, so their walk can be skipped on steps that wrote nothing.
+static bool SameRegisters(const Chip& expected, const Chip& actual, bool comparePages = true)
+{
+    for (size_t page = 0; comparePages && page < Chip::HEAP_PAGES; ++page)
+    {
+        if (expected.GetPageGeneration(page) != actual.GetPageGeneration(page)) { return false; }
+    }
+    return expected.GetHeapGeneration() == actual.GetHeapGeneration() &&
+           expected.GetDisplayGeneration() == actual.GetDisplayGeneration() &&
+           expected.mProgramCounter == actual.mProgramCounter &&
+           expected.mIndexRegister == actual.mIndexRegister &&
+           expected.mInstruction == actual.mInstruction &&
+           expected.mVariableRegisters == actual.mVariableRegisters &&
+           expected.mDelayTimer == actual.mDelayTimer &&
+           expected.mSoundTimer == actual.mSoundTimer &&
+           expected.mStack == actual.mStack;
+}
+
+// Returns a description of the first difference, or an empty string if both machines match.
+static std::string DescribeDifference(const Chip& expected, const Chip& actual)
+{
+    std::ostringstream out;
+    out << std::hex << std::uppercase;
+
+    if (expected.mProgramCounter != actual.mProgramCounter)
+    {
+        out << "PC 0x" << expected.mProgramCounter << " != 0x" << actual.mProgramCounter;
+    }
+    else if (expected.mIndexRegister != actual.mIndexRegister)
+    {
+        out << "I 0x" << expected.mIndexRegister << " != 0x" << actual.mIndexRegister;
+    }
+    else if (expected.mInstruction != actual.mInstruction)
+    {
+        out << "Instruction 0x" << expected.mInstruction << " != 0x" << actual.mInstruction;
+    }
+    else if (expected.mVariableRegisters != actual.mVariableRegisters)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            if (expected.mVariableRegisters[i] == actual.mVariableRegisters[i]) { continue; }
+            out << "V" << i << " 0x" << +expected.mVariableRegisters[i] << " != 0x" << +actual.mVariableRegisters[i];
+            break;
+        }
+    }
+    else if (expected.mDelayTimer != actual.mDelayTimer || expected.mSoundTimer != actual.mSoundTimer)
+    {
+        out << "Timers differ";
+    }
+    else if (expected.mStack != actual.mStack)
+    {
+        out << "Stack differs (depth " << std::dec << expected.mStack.size() << " vs " << actual.mStack.size() << ")";
+    }
+    else if (expected.GetDisplayGeneration() != actual.GetDisplayGeneration())
+    {
+        out << std::dec << "Display written " << expected.GetDisplayGeneration() << " times vs " << actual.GetDisplayGeneration();
+    }
+    else if (expected.mHeap != actual.mHeap)
+    {
+        const auto diff = std::mismatch(expected.mHeap.begin(), expected.mHeap.end(), actual.mHeap.begin());
+        out << "Heap[0x" << (diff.first - expected.mHeap.begin()) << "] 0x" << +*diff.first << " != 0x" << +*diff.second;
+    }
+    else if (expected.mDisplayOutput != actual.mDisplayOutput)
+    {
+        const auto diff = std::mismatch(expected.mDisplayOutput.begin(), expected.mDisplayOutput.end(), actual.mDisplayOutput.begin());
+        const size_t pixel = diff.first - expected.mDisplayOutput.begin();
+        out << std::dec << "Display pixel (" << pixel % OUTPUT_WIDTH << ", " << pixel / OUTPUT_WIDTH << ") differs";
+    }
+    else if (!SameRegisters(expected, actual))
+    {
+        out << "Heap write generations differ";
+    }
+
+    return out.str();
+}
+
+using Candidates = std::array<Chip, gEngines.size()>;
+
+// Runs one input against every engine & every quirk combination, all engines stepping in lockstep with one reference.
+// Chips are passed in so worker threads can reuse their allocations between cases.
+static std::optional<Mismatch> RunCase(const uint8_t* data, size_t size, Chip& reference, Candidates& candidates)
+{
+    static const Chip gPristine;
+
+    for (uint8_t quirks = 0; quirks < QUIRK_COMBINATIONS; ++quirks)
+    {
+        ResetFromImage(reference, gPristine, quirks);
+        LoadCase(reference, data, size);
+        for (Chip& candidate : candidates)
+        {
+            ResetFromImage(candidate, gPristine, quirks);
+            LoadCase(candidate, data, size);
+        }
+
+        for (int step = 0; step < MAX_STEPS; ++step)
+        {
+            // Heap & display are only compared after steps that wrote them on either side, plus once at the end.
+            // Generations matched after the previous step, so any chip moving past these saw a write.
+            const uint16_t programCounter = reference.mProgramCounter;
+            const bool writesHeap = reference.GetMemoryAccess(reference.PeekInstruction()).mWrite;
+            const uint32_t heapGeneration = reference.GetHeapGeneration();
+            const uint32_t displayGeneration = reference.GetDisplayGeneration();
+            const bool timerTick = (step + 1) % STEPS_PER_TIMER_TICK == 0;
+
+            ReferenceStep(reference);
+            if (timerTick) { reference.DecrementTimers(); }
+
+            for (size_t i = 0; i < gEngines.size(); ++i)
+            {
+                Chip& candidate = candidates[i];
+                gEngines[i].mStep(candidate);
+                if (timerTick) { candidate.DecrementTimers(); }
+
+                const bool last = step + 1 == MAX_STEPS;
+                const bool heapWritten = writesHeap || last || reference.GetHeapGeneration() != heapGeneration ||
+                                         candidate.GetHeapGeneration() != heapGeneration;
+                const bool displayWritten = last || reference.GetDisplayGeneration() != displayGeneration ||
+                                            candidate.GetDisplayGeneration() != displayGeneration;
+                if (!SameRegisters(reference, candidate, heapWritten) ||
+                    (heapWritten && reference.mHeap != candidate.mHeap) ||
+                    (displayWritten && reference.mDisplayOutput != candidate.mDisplayOutput))
+                {
+                    return Mismatch{ gEngines[i].mName, quirks, step, programCounter, reference.mInstruction, DescribeDifference(reference, candidate) };
+                }
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+#ifdef CHIP8_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    thread_local Chip reference;
+    thread_local Candidates candidates;
+
+    if (const auto mismatch = RunCase(data, size, reference, candidates))
+    {
+        std::cerr << "Engine '" << mismatch->mEngine << "' diverged at step " << mismatch->mStep
+                  << " (quirks 0x" << std::hex << +mismatch->mQuirkFlags << ", PC 0x" << mismatch->mProgramCounter
+                  << ", opcode 0x" << mismatch->mInstruction << "): " << mismatch->mDescription << std::endl;
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+// Mutation ===========================================================================================================
+using Input = std::vector<uint8_t>;
+
+// Opcode patterns with the operand nibbles cleared, used to generate plausible instructions.
+const std::array<uint16_t, 34> gOpcodePatterns = {
+    0x00E0, 0x00EE, 0x1000, 0x2000, 0x3000, 0x4000, 0x5000, 0x6000, 0x7000,
+    0x8000, 0x8001, 0x8002, 0x8003, 0x8004, 0x8005, 0x8006, 0x8007, 0x800E,
+    0x9000, 0xA000, 0xB000, 0xC000, 0xD000, 0xE09E, 0xE0A1,
+    0xF007, 0xF00A, 0xF015, 0xF018, 0xF01E, 0xF029, 0xF033, 0xF055, 0xF065
+};
+const std::array<uint16_t, 34> gOperandMasks = {
+    0x0000, 0x0000, 0x0FFF, 0x0FFF, 0x0FFF, 0x0FFF, 0x0FF0, 0x0FFF, 0x0FFF,
+    0x0FF0, 0x0FF0, 0x0FF0, 0x0FF0, 0x0FF0, 0x0FF0, 0x0FF0, 0x0FF0, 0x0FF0,
+    0x0FF0, 0x0FFF, 0x0FFF, 0x0FFF, 0x0FFF, 0x0F00, 0x0F00,
+    0x0F00, 0x0F00, 0x0F00, 0x0F00, 0x0F00, 0x0F00, 0x0F00, 0x0F00, 0x0F00
+};
+
+static uint16_t RandomOpcode(std::mt19937& rng)
+{
+    const size_t index = rng() % gOpcodePatterns.size();
+    uint16_t opcode = gOpcodePatterns[index] | (rng() & gOperandMasks[index]);
+
+    // Keep jumps & calls inside the program most of the time so code actually runs.
+    if ((opcode >> 12) == 0x1 || (opcode >> 12) == 0x2)
+    {
+        opcode = (opcode & 0xF000) | (0x200 + (rng() % 0x100) * 2);
+    }
+    return opcode;
+}
+
+static Input RandomInput(std::mt19937& rng)
+{
+    Input input(HEADER_SIZE);
+    for (uint8_t& byte : input) { byte = static_cast<uint8_t>(rng()); }
+
+    const int instructions = 1 + rng() % 128;
+    for (int i = 0; i < instructions; ++i)
+    {
+        const uint16_t opcode = RandomOpcode(rng);
+        input.push_back(opcode >> 8);
+        input.push_back(opcode & 0xFF);
+    }
+    return input;
+}
+
+static void Mutate(Input& input, const std::vector<Input>& corpus, std::mt19937& rng)
+{
+    if (input.size() < HEADER_SIZE) { input.resize(HEADER_SIZE); }
+
+    const int mutations = 1 + rng() % 4;
+    for (int i = 0; i < mutations; ++i)
+    {
+        const size_t programSize = input.size() - HEADER_SIZE;
+        const size_t instructionOffset = HEADER_SIZE + (programSize >= 2 ? (rng() % (programSize / 2)) * 2 : 0);
+
+        switch (rng() % 6)
+        {
+        case 0: // Flip a bit.
+            input[rng() % input.size()] ^= 1 << (rng() % 8);
+            break;
+        case 1: // Replace a byte.
+            input[rng() % input.size()] = static_cast<uint8_t>(rng());
+            break;
+        case 2: // Insert an instruction.
+            if (programSize < MAX_PROGRAM_SIZE)
+            {
+                const uint16_t opcode = RandomOpcode(rng);
+                input.insert(input.begin() + instructionOffset, { static_cast<uint8_t>(opcode >> 8), static_cast<uint8_t>(opcode) });
+            }
+            break;
+        case 3: // Replace an instruction.
+            if (programSize >= 2)
+            {
+                const uint16_t opcode = RandomOpcode(rng);
+                input[instructionOffset] = opcode >> 8;
+                input[instructionOffset + 1] = opcode & 0xFF;
+            }
+            break;
+        case 4: // Delete an instruction.
+            if (programSize >= 2)
+            {
+                input.erase(input.begin() + instructionOffset, input.begin() + instructionOffset + 2);
+            }
+            break;
+        case 5: // Splice in the program of another corpus entry.
+        {
+            const Input& other = corpus[rng() % corpus.size()];
+            if (other.size() > HEADER_SIZE && programSize > 0)
+            {
+                const size_t start = HEADER_SIZE + rng() % (other.size() - HEADER_SIZE);
+                const size_t length = std::min<size_t>(other.size() - start, 1 + rng() % 64);
+                const size_t count = std::min(length, input.size() - instructionOffset);
+                std::copy_n(other.begin() + start, count, input.begin() + instructionOffset);
+            }
+            break;
+        }
+        }
+    }
+
+    if (input.size() - HEADER_SIZE > MAX_PROGRAM_SIZE) { input.resize(HEADER_SIZE + MAX_PROGRAM_SIZE); }
+}
+
+// Minimisation =======================================================================================================
+// Greedily removes instruction ranges, then zeroes individual bytes, keeping each change that still diverges.
+static Input Minimise(Input input)
+{
+    Chip reference;
+    Candidates candidates;
+    auto fails = [&](const Input& attempt) { return RunCase(attempt.data(), attempt.size(), reference, candidates).has_value(); };
+
+    for (size_t chunk = (input.size() - HEADER_SIZE) / 2 & ~size_t(1); chunk >= 2; chunk = (chunk / 2) & ~size_t(1))
+    {
+        for (size_t offset = HEADER_SIZE; offset + chunk <= input.size();)
+        {
+            Input attempt = input;
+            attempt.erase(attempt.begin() + offset, attempt.begin() + offset + chunk);
+            if (fails(attempt)) { input = std::move(attempt); }
+            else { offset += chunk; }
+        }
+    }
+
+    for (size_t i = 0; i < input.size(); ++i)
+    {
+        if (input[i] == 0) { continue; }
+
+        Input attempt = input;
+        attempt[i] = 0;
+        if (fails(attempt)) { input = std::move(attempt); }
+    }
+    return input;
+}
+
+// Driver =============================================================================================================
+static void AddToCorpus(const fs::path& path, std::vector<Input>& corpus)
+{
+    if (fs::is_directory(path))
+    {
+        for (const auto& entry : fs::directory_iterator(path))
+        {
+            // Only ROMs, so a ROM directory's golden.json or configs aren't seeded as programs.
+            const fs::path extension = entry.path().extension();
+            if (entry.is_regular_file() && (extension == ".ch8" || extension == ".c8")) { AddToCorpus(entry.path(), corpus); }
+        }
+        return;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) { std::cerr << "Unable to read " << path << std::endl; return; }
+
+    // Corpus files are plain ROMs, give them an empty header.
+    Input input(HEADER_SIZE);
+    input.insert(input.end(), std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    corpus.push_back(std::move(input));
+}
+
+static void ReportMismatch(const Input& input, const Mismatch& mismatch)
+{
+    std::cout << "Engine '" << mismatch.mEngine << "' diverged from the reference at step " << mismatch.mStep << std::endl;
+    std::cout << std::hex << std::uppercase
+              << "  Quirks: 0x" << +mismatch.mQuirkFlags
+              << "  PC: 0x" << mismatch.mProgramCounter
+              << "  Opcode: 0x" << mismatch.mInstruction << std::dec << std::endl;
+    std::cout << "  " << mismatch.mDescription << std::endl;
+    std::cout << "  Program:" << std::hex;
+    for (size_t i = HEADER_SIZE; i + 1 < input.size(); i += 2)
+    {
+        std::cout << " " << ReadU16(&input[i]);
+    }
+    std::cout << std::dec << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t maxRuns = 0;
+    int maxSeconds = 0;
+    uint32_t seed = std::random_device{}();
+    std::string reproducePath;
+    std::vector<Input> corpus;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--threads" && hasValue)         { threadCount = std::max(1, std::stoi(argv[++i])); }
+        else if (arg == "--runs" && hasValue)       { maxRuns = std::stoull(argv[++i]); }
+        else if (arg == "--seconds" && hasValue)    { maxSeconds = std::stoi(argv[++i]); }
+        else if (arg == "--seed" && hasValue)       { seed = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else if (arg == "--reproduce" && hasValue)  { reproducePath = argv[++i]; }
+        else                                        { AddToCorpus(arg, corpus); }
+    }
+
+    // Replay a saved case instead of fuzzing.
+    if (!reproducePath.empty())
+    {
+        std::ifstream file(reproducePath, std::ios::binary);
+        const Input input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        Chip reference;
+        Candidates candidates;
+        if (const auto mismatch = RunCase(input.data(), input.size(), reference, candidates))
+        {
+            ReportMismatch(input, *mismatch);
+            return 1;
+        }
+        std::cout << "No divergence." << std::endl;
+        return 0;
+    }
+
+    std::mt19937 seeder(seed);
+    if (corpus.empty()) { corpus.push_back(RandomInput(seeder)); }
+
+    std::cout << "Fuzzing " << gEngines.size() << " engine(s) with " << threadCount << " thread(s), seed " << seed
+              << ", corpus of " << corpus.size() << std::endl;
+
+    std::atomic<uint64_t> executions = 0;
+    std::atomic<bool> stop = false;
+    std::mutex failureMutex;
+    std::optional<Input> failure;
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        workers.emplace_back([&, workerSeed = seeder()]()
+        {
+            std::mt19937 rng(workerSeed);
+            Chip reference;
+            Candidates candidates;
+
+            while (!stop)
+            {
+                Input input = (rng() % 10 == 0) ? RandomInput(rng) : corpus[rng() % corpus.size()];
+                Mutate(input, corpus, rng);
+
+                const bool diverged = RunCase(input.data(), input.size(), reference, candidates).has_value();
+                const uint64_t count = ++executions;
+
+                if (diverged)
+                {
+                    std::lock_guard lock(failureMutex);
+                    if (!failure) { failure = std::move(input); }
+                    stop = true;
+                }
+                if (maxRuns != 0 && count >= maxRuns) { stop = true; }
+            }
+        });
+    }
+
+    // Report throughput once per second until done.
+    const auto startTime = std::chrono::steady_clock::now();
+    uint64_t lastExecutions = 0;
+    while (!stop)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        const uint64_t total = executions;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "[" << elapsed << "s] execs: " << total << " (" << (total - lastExecutions) << "/s)" << std::endl;
+        lastExecutions = total;
+
+        if (maxSeconds != 0 && elapsed >= maxSeconds) { stop = true; }
+    }
+
+    for (std::thread& worker : workers) { worker.join(); }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Done: " << executions << " execs in " << seconds << "s (" << static_cast<uint64_t>(executions / seconds) << "/s)" << std::endl;
+
+    if (!failure) { return 0; }
+
+    std::cout << "Divergence found, minimising " << failure->size() << " bytes..." << std::endl;
+    const Input minimal = Minimise(*failure);
+
+    Chip reference;
+    Candidates candidates;
+    ReportMismatch(minimal, *RunCase(minimal.data(), minimal.size(), reference, candidates));
+
+    const std::string outputPath = "fuzz-mismatch-" + std::to_string(std::hash<std::string>{}(std::string(minimal.begin(), minimal.end()))) + ".bin";
+    std::ofstream(outputPath, std::ios::binary).write(reinterpret_cast<const char*>(minimal.data()), minimal.size());
+    std::cout << "Saved to " << outputPath << " (replay with --reproduce)" << std::endl;
+    return 1;
+}
+
+#endif
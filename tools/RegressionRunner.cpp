@@ -0,0 +1,509 @@
+// Golden-frame regression runner, plays every ROM headless for a fixed number of frames with scripted input and
+// compares framebuffer hashes at checkpoints against the stored golden file. Mismatches write a diff image.
+//
+// CHIP8Regression [--roms dir] [--golden file] [--config file] [--frames N] [--interval N] [--ipf N]
+//                 [--threads N] [--diff-dir dir] [--update]
+//                 [--export dir] [--filter nearest|scale2x|scale3x|xbr] [--scale N]
+//                 [--capture dir] [--capture-format gif|apng|y4m] [--capture-scale N]
+//
+// --export writes every checkpoint frame as an upscaled PPM, useful for eyeballing results or documentation.
+// --capture records each ROM's whole run as an animation, one file per ROM.
+#include "Chip8.h"
+#include "FrameCapture.h"
+#include "Upscaler.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+constexpr uint32_t RNG_SEED = 0xC8C8C8C8;
+constexpr size_t PACKED_FRAME_SIZE = OUTPUT_WIDTH * OUTPUT_HEIGHT / 8;
+
+struct Options
+{
+    fs::path mRomDirectory = "roms";
+    fs::path mGoldenPath = "roms/golden.json";
+    fs::path mConfigPath = "config.json";
+    fs::path mDiffDirectory = "regression-diffs";
+    fs::path mExportDirectory; // Empty when not exporting.
+    ScaleFilter mExportFilter = ScaleFilter::Nearest;
+    int mExportScale = 8;
+    fs::path mCaptureDirectory; // Empty when not capturing.
+    CaptureFormat mCaptureFormat = CaptureFormat::GIF;
+    int mCaptureScale = 4;
+    int mFrames = 600;
+    int mCheckpointInterval = 60;
+    int mInstructionsPerFrame = 12; // ~700hz at 60fps, matching the application default.
+    unsigned mThreads = std::max(1u, std::thread::hardware_concurrency());
+    bool mUpdate = false;
+};
+
+struct InputEvent
+{
+    int mFrame = 0;
+    uint8_t mKey = 0;
+    bool mPressed = false;
+};
+
+using PackedFrame = std::array<uint8_t, PACKED_FRAME_SIZE>;
+
+struct Checkpoint
+{
+    int mFrame = 0;
+    uint64_t mHash = 0;
+    PackedFrame mPixels = { 0 };
+};
+
+struct RomResult
+{
+    std::string mName;
+    std::vector<Checkpoint> mCheckpoints;
+    std::vector<std::string> mFailures;
+    bool mMissingGolden = false;
+};
+
+// Framebuffer helpers ================================================================================================
+static PackedFrame PackFrame(const Chip& chip)
+{
+    PackedFrame packed = { 0 };
+    for (size_t i = 0; i < chip.mDisplayOutput.size(); ++i)
+    {
+        packed[i / 8] |= static_cast<uint8_t>((chip.mDisplayOutput[i] != 0) << (7 - i % 8));
+    }
+    return packed;
+}
+
+static uint64_t HashFrame(const PackedFrame& frame)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint8_t byte : frame)
+    {
+        hash = (hash ^ byte) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool GetPixel(const PackedFrame& frame, int x, int y)
+{
+    const int i = y * OUTPUT_WIDTH + x;
+    return (frame[i / 8] >> (7 - i % 8)) & 1;
+}
+
+static std::string ToHex(const uint8_t* data, size_t size)
+{
+    static const char* digits = "0123456789abcdef";
+    std::string out;
+    out.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i)
+    {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0xF];
+    }
+    return out;
+}
+
+static std::string HashToString(uint64_t hash)
+{
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return out.str();
+}
+
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+}
+
+// Returns false for the wrong length or any non-hex character, golden files are hand-editable.
+static bool FromHex(const std::string& text, uint8_t* data, size_t size)
+{
+    if (text.size() != size * 2) { return false; }
+    for (size_t i = 0; i < size; ++i)
+    {
+        const int high = HexDigit(text[i * 2]);
+        const int low = HexDigit(text[i * 2 + 1]);
+        if (high < 0 || low < 0) { return false; }
+        data[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return true;
+}
+
+// Writes a 4x scaled PPM: white = both on, red = missing from actual, green = unexpected in actual.
+static void WriteDiffImage(const fs::path& path, const PackedFrame& expected, const PackedFrame& actual)
+{
+    constexpr int SCALE = 4;
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << OUTPUT_WIDTH * SCALE << " " << OUTPUT_HEIGHT * SCALE << "\n255\n";
+
+    for (int y = 0; y < OUTPUT_HEIGHT * SCALE; ++y)
+    {
+        for (int x = 0; x < OUTPUT_WIDTH * SCALE; ++x)
+        {
+            const bool want = GetPixel(expected, x / SCALE, y / SCALE);
+            const bool have = GetPixel(actual, x / SCALE, y / SCALE);
+
+            uint8_t rgb[3] = { 0, 0, 0 };
+            if (want && have)       { rgb[0] = rgb[1] = rgb[2] = 255; }
+            else if (want)          { rgb[0] = 255; }
+            else if (have)          { rgb[1] = 255; }
+            file.write(reinterpret_cast<const char*>(rgb), 3);
+        }
+    }
+}
+
+// Writes RGBA8888 pixels as a binary PPM, dropping alpha.
+static void WriteImage(const fs::path& path, const uint32_t* pixels, int width, int height)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const uint32_t pixel = pixels[static_cast<size_t>(y) * width + x];
+            row[x * 3] = static_cast<uint8_t>(pixel >> 24);
+            row[x * 3 + 1] = static_cast<uint8_t>(pixel >> 16);
+            row[x * 3 + 2] = static_cast<uint8_t>(pixel >> 8);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+}
+
+// Execution ==========================================================================================================
+static std::vector<InputEvent> ParseInput(const json& romGolden)
+{
+    std::vector<InputEvent> events;
+    for (const json& event : romGolden.value("input", json::array()))
+    {
+        events.push_back({ event.value("frame", 0), static_cast<uint8_t>(event.value("key", 0) & 0xF), event.value("pressed", false) });
+    }
+    return events;
+}
+
+static RomResult RunRom(const fs::path& romPath, const json& romGolden, const Options& options)
+{
+    RomResult result;
+    result.mName = romPath.filename().string();
+
+    std::ifstream file(romPath, std::ios::binary);
+    const std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (rom.empty())
+    {
+        result.mFailures.push_back("Unable to read ROM");
+        return result;
+    }
+
+    Chip chip;
+    chip.mQuirks.ReadConfig(romPath.string(), options.mConfigPath.string());
+    chip.ApplyQuirks();
+    chip.SeedRandom(RNG_SEED);
+    chip.LoadProgram(rom.data(), rom.size());
+
+    const std::vector<InputEvent> input = ParseInput(romGolden);
+    Upscaler upscaler;
+    FrameCapture capture;
+    if (!options.mCaptureDirectory.empty())
+    {
+        const std::string capturePath = (options.mCaptureDirectory / romPath.stem()).string() + FrameCapture::GetExtension(options.mCaptureFormat);
+        if (!capture.Start(capturePath, options.mCaptureFormat, options.mCaptureScale))
+        {
+            result.mFailures.push_back("Unable to start capture " + capturePath);
+        }
+    }
+
+    for (int frame = 1; frame <= options.mFrames; ++frame)
+    {
+        for (const InputEvent& event : input)
+        {
+            if (event.mFrame == frame) { chip.mKeypad[event.mKey] = event.mPressed; }
+        }
+
+        for (int i = 0; i < options.mInstructionsPerFrame; ++i)
+        {
+            chip.Process();
+        }
+        chip.DecrementTimers();
+        capture.SubmitFrame(chip.mDisplayOutput, true); // Nothing is paced here, so wait on the encoder rather than drop.
+
+        if (frame % options.mCheckpointInterval == 0 || frame == options.mFrames)
+        {
+            Checkpoint checkpoint;
+            checkpoint.mFrame = frame;
+            checkpoint.mPixels = PackFrame(chip);
+            checkpoint.mHash = HashFrame(checkpoint.mPixels);
+            result.mCheckpoints.push_back(checkpoint);
+
+            if (!options.mExportDirectory.empty())
+            {
+                const uint32_t* scaled = upscaler.Scale(chip.mDisplayOutput.data(), OUTPUT_WIDTH, OUTPUT_HEIGHT, options.mExportFilter, options.mExportScale);
+                const fs::path exportPath = options.mExportDirectory / (romPath.stem().string() + "_frame" + std::to_string(frame) + ".ppm");
+                WriteImage(exportPath, scaled, upscaler.GetWidth(), upscaler.GetHeight());
+            }
+        }
+    }
+
+    capture.Stop();
+    if (capture.GetDroppedFrames() > 0)
+    {
+        result.mFailures.push_back("capture dropped " + std::to_string(capture.GetDroppedFrames()) + " frame(s)");
+    }
+    if (options.mUpdate) { return result; }
+
+    // Compare against golden.
+    const json goldenCheckpoints = romGolden.value("checkpoints", json::object());
+    if (goldenCheckpoints.empty())
+    {
+        result.mMissingGolden = true;
+        return result;
+    }
+
+    for (const Checkpoint& checkpoint : result.mCheckpoints)
+    {
+        const std::string key = std::to_string(checkpoint.mFrame);
+        if (!goldenCheckpoints.contains(key))
+        {
+            result.mFailures.push_back("frame " + key + ": no golden checkpoint");
+            continue;
+        }
+
+        const json& golden = goldenCheckpoints[key];
+        const json& hash = golden.contains("hash") ? golden["hash"] : json();
+        const json& pixels = golden.contains("pixels") ? golden["pixels"] : json();
+        if (!hash.is_string() || !pixels.is_string())
+        {
+            result.mFailures.push_back("frame " + key + ": malformed golden checkpoint");
+            continue;
+        }
+        if (hash.get<std::string>() == HashToString(checkpoint.mHash))
+        {
+            continue;
+        }
+
+        std::string failure = "frame " + key + ": hash mismatch";
+        PackedFrame expected = { 0 };
+        if (FromHex(pixels.get<std::string>(), expected.data(), expected.size()))
+        {
+            fs::create_directories(options.mDiffDirectory);
+            const fs::path diffPath = options.mDiffDirectory / (romPath.stem().string() + "_frame" + key + ".ppm");
+            WriteDiffImage(diffPath, expected, checkpoint.mPixels);
+            failure += ", diff written to " + diffPath.string();
+        }
+        else
+        {
+            failure += ", golden pixels are malformed";
+        }
+        result.mFailures.push_back(failure);
+    }
+    return result;
+}
+
+// Driver =============================================================================================================
+// Parses a whole decimal argument, clamped to at least 1.
+template <typename T>
+static bool ParseCount(const std::string& text, T& value)
+{
+    T parsed = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (error != std::errc() || end != text.data() + text.size()) { return false; }
+    value = std::max<T>(1, parsed);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        bool validValue = true;
+        if (arg == "--roms" && hasValue)            { options.mRomDirectory = argv[++i]; }
+        else if (arg == "--golden" && hasValue)     { options.mGoldenPath = argv[++i]; }
+        else if (arg == "--config" && hasValue)     { options.mConfigPath = argv[++i]; }
+        else if (arg == "--diff-dir" && hasValue)   { options.mDiffDirectory = argv[++i]; }
+        else if (arg == "--frames" && hasValue)     { validValue = ParseCount(argv[++i], options.mFrames); }
+        else if (arg == "--interval" && hasValue)   { validValue = ParseCount(argv[++i], options.mCheckpointInterval); }
+        else if (arg == "--ipf" && hasValue)        { validValue = ParseCount(argv[++i], options.mInstructionsPerFrame); }
+        else if (arg == "--threads" && hasValue)    { validValue = ParseCount(argv[++i], options.mThreads); }
+        else if (arg == "--update")                 { options.mUpdate = true; }
+        else if (arg == "--export" && hasValue)     { options.mExportDirectory = argv[++i]; }
+        else if (arg == "--scale" && hasValue)      { validValue = ParseCount(argv[++i], options.mExportScale); }
+        else if (arg == "--filter" && hasValue)
+        {
+            if (!Upscaler::ParseFilter(argv[++i], options.mExportFilter))
+            {
+                std::cerr << "Unknown filter: " << argv[i] << std::endl;
+                return 2;
+            }
+        }
+        else if (arg == "--capture" && hasValue)        { options.mCaptureDirectory = argv[++i]; }
+        else if (arg == "--capture-scale" && hasValue)  { validValue = ParseCount(argv[++i], options.mCaptureScale); }
+        else if (arg == "--capture-format" && hasValue)
+        {
+            if (!FrameCapture::ParseFormat(argv[++i], options.mCaptureFormat))
+            {
+                std::cerr << "Unknown capture format: " << argv[i] << std::endl;
+                return 2;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+
+        if (!validValue)
+        {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+
+    json golden = json::object();
+    if (std::ifstream goldenFile(options.mGoldenPath); goldenFile)
+    {
+        golden = json::parse(goldenFile, nullptr, false);
+        if (golden.is_discarded())
+        {
+            std::cerr << "Unable to parse " << options.mGoldenPath << std::endl;
+            return 2;
+        }
+    }
+
+    // Run settings stored in the golden file win, so checkpoints stay comparable.
+    if (!options.mUpdate)
+    {
+        options.mFrames = golden.value("frames", options.mFrames);
+        options.mCheckpointInterval = golden.value("interval", options.mCheckpointInterval);
+        options.mInstructionsPerFrame = golden.value("ipf", options.mInstructionsPerFrame);
+    }
+
+    if (!options.mExportDirectory.empty())
+    {
+        fs::create_directories(options.mExportDirectory);
+    }
+    if (!options.mCaptureDirectory.empty())
+    {
+        fs::create_directories(options.mCaptureDirectory);
+    }
+
+    if (!fs::is_directory(options.mRomDirectory))
+    {
+        std::cerr << "ROM directory not found: " << options.mRomDirectory << std::endl;
+        return 2;
+    }
+
+    std::vector<fs::path> roms;
+    for (const auto& entry : fs::directory_iterator(options.mRomDirectory))
+    {
+        const std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".ch8" || extension == ".rom"))
+        {
+            roms.push_back(entry.path());
+        }
+    }
+    std::sort(roms.begin(), roms.end());
+
+    const json romsGolden = golden.value("roms", json::object());
+    std::vector<RomResult> results(roms.size());
+    std::atomic<size_t> nextRom = 0;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::min<size_t>(options.mThreads, roms.size()); ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t i = nextRom++; i < roms.size(); i = nextRom++)
+            {
+                const std::string name = roms[i].filename().string();
+                results[i] = RunRom(roms[i], romsGolden.value(name, json::object()), options);
+            }
+        });
+    }
+    for (std::thread& worker : workers) { worker.join(); }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (options.mUpdate)
+    {
+        golden["frames"] = options.mFrames;
+        golden["interval"] = options.mCheckpointInterval;
+        golden["ipf"] = options.mInstructionsPerFrame;
+
+        for (const RomResult& result : results)
+        {
+            // Keep any hand-written input script.
+            json& romGolden = golden["roms"][result.mName];
+            romGolden["checkpoints"] = json::object();
+            for (const Checkpoint& checkpoint : result.mCheckpoints)
+            {
+                romGolden["checkpoints"][std::to_string(checkpoint.mFrame)] = {
+                    { "hash", HashToString(checkpoint.mHash) },
+                    { "pixels", ToHex(checkpoint.mPixels.data(), checkpoint.mPixels.size()) }
+                };
+            }
+        }
+
+        std::ofstream(options.mGoldenPath) << golden.dump(4);
+        std::cout << "Updated " << results.size() << " ROM(s) in " << options.mGoldenPath << " (" << seconds << "s)" << std::endl;
+
+        // Only capture problems can fail an update.
+        int failed = 0;
+        for (const RomResult& result : results)
+        {
+            for (const std::string& failure : result.mFailures)
+            {
+                std::cout << "[FAIL] " << result.mName << ": " << failure << std::endl;
+            }
+            failed += result.mFailures.empty() ? 0 : 1;
+        }
+        return failed == 0 ? 0 : 1;
+    }
+
+    // Skipped ROMs fail the run too, a ROM added without golden data would otherwise never be checked.
+    int failed = 0;
+    int skipped = 0;
+    for (const RomResult& result : results)
+    {
+        if (result.mMissingGolden)
+        {
+            std::cout << "[SKIP] " << result.mName << " (no golden data, run with --update)" << std::endl;
+            skipped++;
+        }
+        else if (result.mFailures.empty())
+        {
+            std::cout << "[PASS] " << result.mName << std::endl;
+        }
+        else
+        {
+            std::cout << "[FAIL] " << result.mName << std::endl;
+            for (const std::string& failure : result.mFailures)
+            {
+                std::cout << "       " << failure << std::endl;
+            }
+            failed++;
+        }
+    }
+
+    std::cout << results.size() - failed - skipped << "/" << results.size() << " ROM(s) passed";
+    if (skipped > 0) { std::cout << ", " << skipped << " skipped"; }
+    std::cout << " in " << seconds << "s" << std::endl;
+    return failed == 0 && skipped == 0 ? 0 : 1;
+}
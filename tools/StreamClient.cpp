@@ -0,0 +1,268 @@
+// Reference client for StreamServer, for testing a stream on the local machine.
+//
+// CHIP8StreamClient [address] [--frames N] [--tap key] [--show]
+//
+// address is "unix:/path/to/socket", "host:port" or "port" (default 5800 on 127.0.0.1). Frames are decoded & checked
+// as they arrive, then bytes per frame, delivery latency & ping round trips are reported on exit. Delivery latency
+// compares the server's steady clock timestamp against ours, so it's only meaningful on the same machine.
+// --frames stops after N frames (default: until the server disconnects), --tap presses & releases a keypad key
+// once the first frame arrives, --show prints the last frame as text.
+#include "StreamServer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+constexpr int PING_INTERVAL = 60;                      // Frames between pings.
+constexpr uint64_t TAP_MICROSECONDS = 10 * 1000000 / 60; // A tapped key is held for 10 frames, frames or not.
+
+static int Connect(const std::string& address)
+{
+    if (address.starts_with("unix:"))
+    {
+        sockaddr_un local = {};
+        local.sun_family = AF_UNIX;
+        const std::string path = address.substr(5);
+        if (path.empty() || path.size() >= sizeof(local.sun_path)) { return -1; }
+        memcpy(local.sun_path, path.c_str(), path.size());
+
+        const int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socket >= 0 && connect(socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0) { return socket; }
+        if (socket >= 0) { close(socket); }
+        return -1;
+    }
+
+    const size_t colon = address.rfind(':');
+    const std::string host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+    const std::string port = colon == std::string::npos ? address : address.substr(colon + 1);
+
+    sockaddr_in inet = {};
+    inet.sin_family = AF_INET;
+    inet.sin_port = htons(static_cast<uint16_t>(std::stoi(port)));
+    if (inet_pton(AF_INET, host.c_str(), &inet.sin_addr) != 1) { return -1; }
+
+    const int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (socket >= 0 && connect(socket, reinterpret_cast<sockaddr*>(&inet), sizeof(inet)) == 0)
+    {
+        const int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        return socket;
+    }
+    if (socket >= 0) { close(socket); }
+    return -1;
+}
+
+static bool SendMessage(int socket, StreamMessage type, const std::vector<uint8_t>& payload)
+{
+    std::vector<uint8_t> message;
+    StreamCodec::AppendHeader(message, type, static_cast<uint32_t>(payload.size()));
+    message.insert(message.end(), payload.begin(), payload.end());
+    return send(socket, message.data(), message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size());
+}
+
+static bool SendKey(int socket, uint8_t key, bool pressed)
+{
+    return SendMessage(socket, StreamMessage::Key, { key, static_cast<uint8_t>(pressed) });
+}
+
+static bool SendPing(int socket)
+{
+    const uint64_t timestamp = StreamCodec::GetTimestamp();
+    std::vector<uint8_t> payload(sizeof(timestamp));
+    memcpy(payload.data(), &timestamp, sizeof(timestamp));
+    return SendMessage(socket, StreamMessage::Ping, payload);
+}
+
+static float Percentile(std::vector<float> samples, float percentile)
+{
+    if (samples.empty()) { return 0.f; }
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, static_cast<size_t>(percentile * samples.size()))];
+}
+
+int main(int argc, char* argv[])
+{
+    std::string address = "5800";
+    int frameLimit = 0;
+    int tapKey = -1;
+    bool show = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--frames" && hasValue)      { frameLimit = std::max(0, std::stoi(argv[++i])); }
+        else if (arg == "--tap" && hasValue)    { tapKey = std::stoi(argv[++i], nullptr, 16) & 0xF; }
+        else if (arg == "--show")               { show = true; }
+        else if (!arg.starts_with("--"))        { address = arg; }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    const int socket = Connect(address);
+    if (socket < 0)
+    {
+        std::cerr << "Unable to connect to " << address << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    StreamFrame frame = {};
+    bool hasFrame = false;
+    int frames = 0, keyframes = 0;
+    uint64_t tapRelease = 0; // Timestamp to release the tapped key at, 0 once released.
+    uint32_t lastTick = 0;
+    uint64_t frameBytes = 0;
+    std::vector<float> latencies, roundTrips;
+
+    std::vector<uint8_t> input;
+    std::vector<uint8_t> buffer(4096);
+    bool running = true;
+    while (running && (frameLimit == 0 || frames < frameLimit))
+    {
+        // The release is timed rather than counted in frames, a static screen sends none.
+        int timeout = -1;
+        if (tapRelease != 0)
+        {
+            const uint64_t now = StreamCodec::GetTimestamp();
+            if (now >= tapRelease)
+            {
+                SendKey(socket, static_cast<uint8_t>(tapKey), false);
+                tapRelease = 0;
+            }
+            else
+            {
+                timeout = static_cast<int>((tapRelease - now + 999) / 1000);
+            }
+        }
+
+        pollfd descriptor = { socket, POLLIN, 0 };
+        const int ready = poll(&descriptor, 1, timeout);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) { continue; }
+        if (ready < 0) { break; }
+
+        const ssize_t received = recv(socket, buffer.data(), buffer.size(), 0);
+        if (received <= 0)
+        {
+            if (received < 0 && errno == EINTR) { continue; }
+            break;
+        }
+        input.insert(input.end(), buffer.begin(), buffer.begin() + received);
+
+        size_t offset = 0;
+        while (running && input.size() - offset >= STREAM_HEADER_SIZE)
+        {
+            uint32_t length = 0;
+            memcpy(&length, &input[offset + 1], sizeof(length));
+            if (input.size() - offset < STREAM_HEADER_SIZE + length) { break; }
+
+            const StreamMessage type = static_cast<StreamMessage>(input[offset]);
+            const uint8_t* payload = &input[offset + STREAM_HEADER_SIZE];
+            offset += STREAM_HEADER_SIZE + length;
+
+            if (type == StreamMessage::Hello)
+            {
+                uint16_t width = 0, height = 0;
+                if (length >= 5)
+                {
+                    memcpy(&width, payload + 1, sizeof(width));
+                    memcpy(&height, payload + 3, sizeof(height));
+                }
+                if (length < 5)
+                {
+                    std::cerr << "Malformed hello message" << std::endl;
+                    running = false;
+                }
+                else if (payload[0] != STREAM_VERSION || width != OUTPUT_WIDTH || height != OUTPUT_HEIGHT)
+                {
+                    std::cerr << "Server streams version " << int(payload[0]) << " at " << width << "x" << height
+                              << ", this client was built for version " << int(STREAM_VERSION) << " at " << OUTPUT_WIDTH << "x" << OUTPUT_HEIGHT << std::endl;
+                    running = false;
+                }
+                continue;
+            }
+            if (type == StreamMessage::Pong && length >= 8)
+            {
+                uint64_t sent = 0;
+                memcpy(&sent, payload, sizeof(sent));
+                roundTrips.push_back(static_cast<float>(StreamCodec::GetTimestamp() - sent));
+                continue;
+            }
+            if (type != StreamMessage::Keyframe && type != StreamMessage::Delta) { continue; }
+            if (length < 12)
+            {
+                std::cerr << "Malformed frame message" << std::endl;
+                running = false;
+                continue;
+            }
+
+            uint32_t tick = 0;
+            uint64_t timestamp = 0;
+            memcpy(&tick, payload, sizeof(tick));
+            memcpy(&timestamp, payload + 4, sizeof(timestamp));
+            if (type == StreamMessage::Keyframe)
+            {
+                if (length != 12 + STREAM_FRAME_BYTES)
+                {
+                    std::cerr << "Malformed keyframe at tick " << tick << std::endl;
+                    running = false;
+                    continue;
+                }
+                memcpy(frame.data(), payload + 12, STREAM_FRAME_BYTES);
+                hasFrame = true;
+                keyframes++;
+            }
+            else if (!hasFrame || !StreamCodec::ApplyDelta(payload + 12, length - 12, frame))
+            {
+                std::cerr << "Malformed delta at tick " << tick << std::endl;
+                running = false;
+                continue;
+            }
+
+            latencies.push_back(static_cast<float>(StreamCodec::GetTimestamp() - timestamp));
+            frameBytes += STREAM_HEADER_SIZE + length;
+            lastTick = tick;
+            frames++;
+
+            if (frames % PING_INTERVAL == 1) { SendPing(socket); }
+            if (tapKey >= 0 && frames == 1)
+            {
+                SendKey(socket, static_cast<uint8_t>(tapKey), true);
+                tapRelease = StreamCodec::GetTimestamp() + TAP_MICROSECONDS;
+            }
+            if (frameLimit != 0 && frames >= frameLimit) { running = false; }
+        }
+        input.erase(input.begin(), input.begin() + offset);
+    }
+    if (tapRelease != 0) { SendKey(socket, static_cast<uint8_t>(tapKey), false); }
+    close(socket);
+
+    printf("%d frames (%d keyframes) up to tick %u, %.1f bytes/frame\n", frames, keyframes, lastTick,
+           frames > 0 ? static_cast<double>(frameBytes) / frames : 0.0);
+    printf("Delivery latency: p50 %.0f us, p99 %.0f us, max %.0f us\n",
+           Percentile(latencies, 0.5f), Percentile(latencies, 0.99f), Percentile(latencies, 1.f));
+    printf("Ping round trip:  p50 %.0f us over %zu pings\n", Percentile(roundTrips, 0.5f), roundTrips.size());
+
+    if (show && hasFrame)
+    {
+        for (size_t y = 0; y < OUTPUT_HEIGHT; ++y)
+        {
+            for (size_t x = 0; x < OUTPUT_WIDTH; ++x)
+            {
+                putchar((frame[y * STREAM_ROW_BYTES + x / 8] >> (7 - x % 8)) & 1 ? '#' : '.');
+            }
+            putchar('\n');
+        }
+    }
+    return 0;
+}
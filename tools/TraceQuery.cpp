@@ -0,0 +1,113 @@
+// Queries a trace recorded by TraceRecorder, the file is memory mapped & decoded as it's read so queries over large
+// traces stay cheap.
+//
+// CHIP8Trace <file> info
+// CHIP8Trace <file> dump [start] [count]          Print records from start (default 0, 100 records).
+// CHIP8Trace <file> writes <address>              Every instruction that wrote the heap byte at address.
+// CHIP8Trace <file> before-pc <address> [count]   The count instructions (default 1000) before PC first hit address.
+// CHIP8Trace <file> pc <address>                  Every execution of the instruction at address.
+//
+// Addresses accept decimal or 0x prefixed hex.
+#include "RomAnalysis.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+static void PrintRecord(uint64_t index, const TraceRecord& record)
+{
+    printf("#%-10llu frame %-6u PC 0x%03X  %04X  %-32s I=0x%03X",
+           static_cast<unsigned long long>(index), record.mFrame, record.mProgramCounter, record.mInstruction,
+           RomAnalysis::Disassemble(record.mInstruction).c_str(), record.mIndexRegister);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        if (record.mChangedRegisters & (1 << i)) { printf(" V%X=0x%02X", i, record.mRegisters[i]); }
+    }
+
+    if (record.mWriteLength > 0)
+    {
+        printf("  [0x%03X] <-", record.mWriteAddress);
+        for (uint8_t i = 0; i < record.mWriteLength; ++i) { printf(" %02X", record.mWriteData[i]); }
+    }
+    printf("\n");
+}
+
+static bool WritesTo(const TraceRecord& record, uint16_t address)
+{
+    // Distance from the write start, wrapping like the heap does.
+    const uint16_t offset = (address - record.mWriteAddress) & (HEAP_SIZE - 1);
+    return offset < record.mWriteLength;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: CHIP8Trace <file> info | dump [start] [count] | writes <address> | before-pc <address> [count] | pc <address>" << std::endl;
+        return 2;
+    }
+
+    TraceFile trace;
+    if (!trace.Open(argv[1]))
+    {
+        std::cerr << "Unable to open trace " << argv[1] << std::endl;
+        return 1;
+    }
+
+    const std::string command = argv[2];
+    auto argument = [&](int index, uint64_t fallback) -> uint64_t { return argc > index ? std::stoull(argv[index], nullptr, 0) : fallback; };
+    const uint64_t count = trace.GetRecordCount();
+
+    if (command == "info")
+    {
+        uint32_t lastFrame = count > 0 ? trace.GetRecord(count - 1).mFrame : 0;
+        printf("%llu instructions over %u frames\n", static_cast<unsigned long long>(count), lastFrame);
+    }
+    else if (command == "dump")
+    {
+        const uint64_t start = argument(3, 0);
+        const uint64_t end = std::min(count, start + argument(4, 100));
+        for (uint64_t i = start; i < end; ++i) { PrintRecord(i, trace.GetRecord(i)); }
+    }
+    else if (command == "writes" && argc > 3)
+    {
+        const uint16_t address = static_cast<uint16_t>(argument(3, 0));
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            const TraceRecord record = trace.GetRecord(i);
+            if (WritesTo(record, address)) { PrintRecord(i, record); }
+        }
+    }
+    else if (command == "before-pc" && argc > 3)
+    {
+        const uint16_t address = static_cast<uint16_t>(argument(3, 0));
+        const uint64_t history = argument(4, 1000);
+
+        uint64_t hit = 0;
+        while (hit < count && trace.GetRecord(hit).mProgramCounter != address) { ++hit; }
+        if (hit == count)
+        {
+            std::cerr << "PC never reached " << argv[3] << std::endl;
+            return 1;
+        }
+
+        for (uint64_t i = hit > history ? hit - history : 0; i <= hit; ++i) { PrintRecord(i, trace.GetRecord(i)); }
+    }
+    else if (command == "pc" && argc > 3)
+    {
+        const uint16_t address = static_cast<uint16_t>(argument(3, 0));
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            const TraceRecord record = trace.GetRecord(i);
+            if (record.mProgramCounter == address) { PrintRecord(i, record); }
+        }
+    }
+    else
+    {
+        std::cerr << "Unknown command " << command << std::endl;
+        return 2;
+    }
+    return 0;
+}